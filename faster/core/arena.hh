@@ -0,0 +1,236 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_ARENA_HH__
+#define __FASTER_CORE_ARENA_HH__
+
+/*
+ * Arenas
+ *
+ * SUMMARY
+ *
+ * An arena is a monotonic std::pmr::memory_resource: allocating bumps a
+ * pointer, deallocating does nothing, and reset releases everything at once.
+ * It is meant for objects living as long as a single request (or frame, or
+ * transaction).  They are built on the arena, and after the request all of
+ * them are dropped with a single reset, which does not depend on the number
+ * of allocations.  Note that destructors of the objects still have to run if
+ * they do anything besides deallocating.
+ *
+ * Unlike std::pmr::monotonic_buffer_resource::release, reset keeps the
+ * largest chunk allocated so far, so an arena reused for many requests of
+ * similar size stops allocating from its upstream resource at all.
+ *
+ * The *_PMR property variants build their fields and values on the memory
+ * resource of the object, which is declared by FASTER_MEMORY_RESOURCE and
+ * may be an arena.
+ *
+ * An arena is not thread-safe.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <new>
+
+namespace faster::core
+{
+  class arena final : public std::pmr::memory_resource
+  {
+  public:
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 4096;
+
+    explicit
+    arena (std::size_t chunk_size = DEFAULT_CHUNK_SIZE,
+           std::pmr::memory_resource *upstream
+             = std::pmr::get_default_resource ())
+      noexcept
+      : upstream_ {upstream}, chunks_ {nullptr}, current_ {nullptr},
+        left_ {0}, next_size_ {std::max (chunk_size, MIN_CHUNK_SIZE)}
+    {
+    }
+
+    arena (const arena &) = delete;
+    arena &operator= (const arena &) = delete;
+
+    ~arena ()
+    {
+      release (nullptr);
+    }
+
+    /*
+     * Releases all allocations, keeping the largest chunk for reuse.
+     */
+    void
+    reset ()
+      noexcept
+    {
+      chunk *largest = chunks_;
+
+      for (chunk *c = chunks_; c; c = c->next)
+        if (c->size > largest->size)
+          largest = c;
+
+      release (largest);
+
+      if (largest)
+        {
+          largest->next = nullptr;
+          chunks_ = largest;
+          current_ = largest->data ();
+          left_ = largest->size - sizeof (chunk);
+        }
+    }
+
+    std::pmr::memory_resource *
+    upstream ()
+      const noexcept
+    {
+      return upstream_;
+    }
+
+  protected:
+    void *
+    do_allocate (std::size_t bytes,
+                 std::size_t alignment)
+      override
+    {
+      void *result = current_;
+
+      if (!result || !std::align (alignment, bytes, result, left_))
+        {
+          // The new chunk has room for bytes at any alignment.
+          grow (bytes, alignment);
+          result = current_;
+          std::align (alignment, bytes, result, left_);
+        }
+
+      current_ = static_cast<char *> (result) + bytes;
+      left_ -= bytes;
+      return result;
+    }
+
+    void
+    do_deallocate (void *,
+                   std::size_t,
+                   std::size_t)
+      override
+    {
+    }
+
+    bool
+    do_is_equal (const std::pmr::memory_resource &other)
+      const noexcept override
+    {
+      return this == &other;
+    }
+
+  private:
+    static constexpr std::size_t MIN_CHUNK_SIZE = 256;
+
+    // The header of a chunk, its data follow.
+    struct alignas (std::max_align_t) chunk
+    {
+      chunk *next;
+      std::size_t size;
+
+      char *
+      data ()
+        noexcept
+      {
+        return reinterpret_cast<char *> (this + 1);
+      }
+    };
+
+    // Chunks grow geometrically, so there are only logarithmically many.
+    void
+    grow (std::size_t bytes,
+          std::size_t alignment)
+    {
+      constexpr std::size_t MAX_SIZE
+        = std::numeric_limits<std::size_t>::max ();
+
+      if (bytes > MAX_SIZE - sizeof (chunk) - alignment)
+        throw std::bad_alloc {};
+
+      std::size_t needed = sizeof (chunk) + bytes + alignment;
+      std::size_t size = next_size_;
+
+      while (size < needed)
+        size = size <= MAX_SIZE / 2 ? size * 2 : needed;
+
+      auto c = static_cast<chunk *> (upstream_->allocate (size,
+                                                          alignof (chunk)));
+      c->next = chunks_;
+      c->size = size;
+
+      chunks_ = c;
+      current_ = c->data ();
+      left_ = size - sizeof (chunk);
+      next_size_ = size <= MAX_SIZE / 2 ? size * 2 : size;
+    }
+
+    // Returns all chunks except keep to upstream.
+    void
+    release (chunk *keep)
+      noexcept
+    {
+      chunk *c = chunks_;
+
+      while (c)
+        {
+          chunk *next = c->next;
+
+          if (c != keep)
+            upstream_->deallocate (c, c->size, alignof (chunk));
+
+          c = next;
+        }
+
+      chunks_ = nullptr;
+      current_ = nullptr;
+      left_ = 0;
+    }
+
+    std::pmr::memory_resource *upstream_;
+    chunk *chunks_;
+    void *current_;
+    std::size_t left_;
+    std::size_t next_size_;
+  };
+}
+
+/**
+ * Declares the memory resource used by *_PMR properties, and the
+ * faster_memory_resource method returning it.  It has to precede the
+ * properties and can be initialized by constructors, it defaults to
+ * std::pmr::get_default_resource ().
+ */
+#define FASTER_MEMORY_RESOURCE \
+  private: \
+  std::pmr::memory_resource *faster_memory_resource_ \
+    = std::pmr::get_default_resource (); \
+  \
+  public: \
+  std::pmr::memory_resource * \
+  faster_memory_resource () const noexcept \
+  { \
+    return faster_memory_resource_; \
+  }
+
+#endif /* __FASTER_CORE_ARENA_HH__ */
@@ -0,0 +1,153 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Building and tearing down batches of request-like objects whose
+ * properties are strings and vectors: FASTER_PROPERTY on the default heap
+ * against *_PMR on a faster::core::arena, reset after every batch.  The
+ * arguments are the number of objects per batch and the number of batches.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include <faster/core/arena.hh>
+#include <faster/core/property.hh>
+
+namespace
+{
+  constexpr std::size_t HEADERS = 8;
+
+  const std::string PATH (60, 'p');
+  const std::string HEADER (40, 'h');
+  const std::string BODY (200, 'b');
+
+  struct heap_request
+  {
+    FASTER_PROPERTY (path, std::string)
+    FASTER_PROPERTY (headers, std::vector<std::string>)
+    FASTER_PROPERTY (body, std::string)
+  };
+
+  struct arena_request
+  {
+    explicit
+    arena_request (std::pmr::memory_resource *resource)
+      : faster_memory_resource_ {resource}
+    {
+    }
+
+    FASTER_MEMORY_RESOURCE
+    FASTER_PROPERTY_PMR (path, std::pmr::string)
+    FASTER_PROPERTY_PMR (headers, std::pmr::vector<std::pmr::string>)
+    FASTER_PROPERTY_PMR (body, std::pmr::string)
+  };
+
+  template <typename Request>
+  void
+  fill (Request &request)
+  {
+    request.path_emplace (PATH.data (), PATH.size ());
+
+    for (std::size_t i = 0; i < HEADERS; i ++)
+      request.headers ().emplace_back (HEADER.data (), HEADER.size ());
+
+    request.body_emplace (BODY.data (), BODY.size ());
+  }
+
+  // The heap path has no emplace, construct then move.
+  void
+  fill (heap_request &request)
+  {
+    request.path (std::string (PATH.data (), PATH.size ()));
+
+    for (std::size_t i = 0; i < HEADERS; i ++)
+      request.headers ().emplace_back (HEADER.data (), HEADER.size ());
+
+    request.body (std::string (BODY.data (), BODY.size ()));
+  }
+
+  double
+  run_heap (unsigned long objects,
+            unsigned long batches)
+  {
+    auto start = std::chrono::steady_clock::now ();
+
+    for (unsigned long b = 0; b < batches; b ++)
+      {
+        std::vector<heap_request> requests;
+        requests.reserve (objects);
+
+        for (unsigned long i = 0; i < objects; i ++)
+          fill (requests.emplace_back ());
+      }
+
+    std::chrono::duration<double, std::nano> elapsed
+      = std::chrono::steady_clock::now () - start;
+
+    return elapsed.count () / (objects * batches);
+  }
+
+  double
+  run_arena (unsigned long objects,
+             unsigned long batches)
+  {
+    faster::core::arena arena;
+
+    auto start = std::chrono::steady_clock::now ();
+
+    for (unsigned long b = 0; b < batches; b ++)
+      {
+        {
+          std::pmr::vector<arena_request> requests {&arena};
+          requests.reserve (objects);
+
+          for (unsigned long i = 0; i < objects; i ++)
+            fill (requests.emplace_back (&arena));
+        }
+
+        arena.reset ();
+      }
+
+    std::chrono::duration<double, std::nano> elapsed
+      = std::chrono::steady_clock::now () - start;
+
+    return elapsed.count () / (objects * batches);
+  }
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  unsigned long objects = argc > 1 ? std::atol (argv[1]) : 1000;
+  unsigned long batches = argc > 2 ? std::atol (argv[2]) : 1000;
+
+  std::cout << std::fixed << std::setprecision (1);
+  std::cout << "ns/object, " << objects << " objects per batch\n";
+  std::cout << "default heap  " << std::setw (8)
+    << run_heap (objects, batches) << '\n';
+  std::cout << "arena         " << std::setw (8)
+    << run_arena (objects, batches) << '\n';
+
+  return 0;
+}
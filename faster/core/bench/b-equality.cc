@@ -0,0 +1,181 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares the equality and hashing generated for schema classes with the
+ * usual hand-written field by field versions, on hash sets of N records
+ * (10M by default, or the first argument).
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "b-equality.hh"
+
+namespace
+{
+  struct naive_record
+  {
+    std::uint64_t id;
+    std::uint32_t user;
+    std::uint16_t flags;
+    std::uint8_t kind;
+    bool active;
+    std::uint64_t parent;
+    std::uint32_t count;
+    std::uint16_t shard;
+    std::uint8_t level;
+
+    bool
+    operator== (const naive_record &other) const
+    {
+      return id == other.id
+        && user == other.user
+        && flags == other.flags
+        && kind == other.kind
+        && active == other.active
+        && parent == other.parent
+        && count == other.count
+        && shard == other.shard
+        && level == other.level;
+    }
+  };
+
+  template <typename T>
+  inline void
+  combine (std::size_t &seed,
+           const T &value)
+  {
+    seed ^= std::hash<T> {} (value) + 0x9E3779B9 + (seed << 6) + (seed >> 2);
+  }
+
+  struct naive_hasher
+  {
+    std::size_t
+    operator() (const naive_record &r) const noexcept
+    {
+      std::size_t seed = 0;
+      combine (seed, r.id);
+      combine (seed, r.user);
+      combine (seed, r.flags);
+      combine (seed, r.kind);
+      combine (seed, r.active);
+      combine (seed, r.parent);
+      combine (seed, r.count);
+      combine (seed, r.shard);
+      combine (seed, r.level);
+      return seed;
+    }
+  };
+
+  template <typename F>
+  inline double
+  measure (F &&f)
+  {
+    auto start = std::chrono::steady_clock::now ();
+    f ();
+    std::chrono::duration<double, std::milli> elapsed
+      = std::chrono::steady_clock::now () - start;
+    return elapsed.count ();
+  }
+
+  template <typename Record, typename Hasher>
+  void
+  run (const char *name,
+       const std::vector<Record> &records)
+  {
+    std::size_t sink = 0;
+    Hasher hasher;
+
+    double hash_ms = measure ([&] () {
+      for (const auto &r : records)
+        sink += hasher (r);
+    });
+
+    std::unordered_set<Record, Hasher> set;
+    set.reserve (records.size ());
+
+    double insert_ms = measure ([&] () {
+      for (const auto &r : records)
+        set.insert (r);
+    });
+
+    double find_ms = measure ([&] () {
+      for (const auto &r : records)
+        sink += set.count (r);
+    });
+
+    std::cout << name << ": hash " << hash_ms << " ms, insert " << insert_ms
+      << " ms, find " << find_ms << " ms (" << set.size () << " unique, "
+      << sink % 2 << ")\n";
+  }
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  std::size_t n = argc > 1 ? std::strtoull (argv[1], nullptr, 10) : 10000000;
+
+  std::vector<bench_record> generated (n);
+  std::vector<naive_record> naive (n);
+  std::mt19937_64 random {42};
+
+  for (std::size_t i = 0; i < n; i ++)
+    {
+      // Some duplicates, so that lookups compare equal records as well.
+      std::uint64_t id = random () % (n - n / 8 + 1);
+      auto user = static_cast<std::uint32_t> (id * 7);
+      auto flags = static_cast<std::uint16_t> (id);
+      auto kind = static_cast<std::uint8_t> (id % 5);
+      bool active = id & 1;
+      std::uint64_t parent = id / 3;
+      auto count = static_cast<std::uint32_t> (id % 1000);
+      auto shard = static_cast<std::uint16_t> (id % 64);
+      auto level = static_cast<std::uint8_t> (id % 3);
+
+      bench_record &g = generated[i];
+      g.id (id);
+      g.user (user);
+      g.flags (flags);
+      g.kind (kind);
+      g.active (active);
+      g.parent (parent);
+      g.count (count);
+      g.shard (shard);
+      g.level (level);
+
+      naive[i] = {id, user, flags, kind, active, parent, count, shard, level};
+    }
+
+  std::cout << n << " records, sizeof generated " << sizeof (bench_record)
+    << ", naive " << sizeof (naive_record) << '\n';
+
+  run<naive_record, naive_hasher> ("naive    ", naive);
+  naive.clear ();
+  naive.shrink_to_fit ();
+  run<bench_record, bench_record::hasher> ("generated", generated);
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Read scaling of *_RWLOCK (std::shared_mutex) and *_DRWLOCK
+ * (faster::core::distributed_shared_mutex) properties, from 1 to 64 threads
+ * (or the first argument), each doing 1% writes.  The second argument is the
+ * number of operations per thread.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <faster/core/property.hh>
+#include <faster/core/shared_mutex.hh>
+
+namespace
+{
+  struct shared_mutex_config
+  {
+    FASTER_PROPERTY_PBV_RWLOCK (limit, std::uint64_t)
+  };
+
+  struct distributed_config
+  {
+    FASTER_PROPERTY_PBV_DRWLOCK (limit, std::uint64_t)
+  };
+
+  template <typename Config>
+  double
+  run (unsigned threads,
+       unsigned long operations)
+  {
+    Config config {};
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now ();
+
+    for (unsigned t = 0; t < threads; t ++)
+      workers.emplace_back ([&config, operations, t] () {
+        std::uint64_t sink = 0;
+
+        for (unsigned long i = 0; i < operations; i ++)
+          if ((i + t) % 100 == 0)
+            {
+              std::unique_lock lock {config.limit_lock ()};
+              config.limit (config.limit () + 1);
+            }
+          else
+            {
+              std::shared_lock lock {config.limit_lock ()};
+              sink += config.limit ();
+            }
+
+        // Keep the reads.
+        if (sink == 1)
+          std::abort ();
+      });
+
+    for (auto &worker : workers)
+      worker.join ();
+
+    std::chrono::duration<double, std::micro> elapsed
+      = std::chrono::steady_clock::now () - start;
+
+    return threads * operations / elapsed.count ();
+  }
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  unsigned max_threads = argc > 1 ? std::atoi (argv[1]) : 64;
+  unsigned long operations = argc > 2 ? std::atol (argv[2]) : 1000000;
+
+  std::cout << "operations/us, 1% writes\n";
+  std::cout << "threads  std::shared_mutex  distributed_shared_mutex\n";
+  std::cout << std::fixed << std::setprecision (1);
+
+  for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    std::cout << std::setw (7) << threads
+      << std::setw (19) << run<shared_mutex_config> (threads, operations)
+      << std::setw (26) << run<distributed_config> (threads, operations)
+      << '\n';
+
+  return 0;
+}
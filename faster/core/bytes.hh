@@ -0,0 +1,147 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_BYTES_HH__
+#define __FASTER_CORE_BYTES_HH__
+
+/*
+ * Raw bytes
+ *
+ * SUMMARY
+ *
+ * Comparison and non-cryptographic hashing of raw bytes, used by the equality
+ * and hashing code generated for schema classes (see gen_property.cc).
+ *
+ * equal_bytes compares a compile-time number of bytes using word loads, the
+ * last one overlapping the previous if needed.  Unlike memcmp, which is
+ * usually a library call for sizes other than small powers of two, it
+ * compiles to a few branch-free instructions.
+ *
+ * hash_bytes consumes the input 16 bytes at a time in two independent lanes,
+ * which keeps two multipliers busy and lets the compiler use vector loads.
+ * The tail is read using an overlapping load as well.  The lanes are merged
+ * and avalanched at the end.  The result depends on the byte order of the
+ * machine, so it must not be stored or sent anywhere.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace faster::core
+{
+  namespace detail
+  {
+    constexpr std::uint64_t HASH_K1 = 0x9E3779B97F4A7C15;
+    constexpr std::uint64_t HASH_K2 = 0xC2B2AE3D27D4EB4F;
+
+    constexpr inline std::uint64_t
+    hash_mix (std::uint64_t x)
+      noexcept
+    {
+      x ^= x >> 33;
+      x *= 0xFF51AFD7ED558CCD;
+      x ^= x >> 33;
+      x *= 0xC4CEB9FE1A85EC53;
+      x ^= x >> 33;
+      return x;
+    }
+
+    inline std::uint64_t
+    hash_load (const unsigned char *p)
+      noexcept
+    {
+      std::uint64_t w;
+      std::memcpy (&w, p, sizeof w);
+      return w;
+    }
+  }
+
+  template <std::size_t Size>
+  inline bool
+  equal_bytes (const void *a,
+               const void *b)
+    noexcept
+  {
+    if constexpr (Size < sizeof (std::uint64_t))
+      return std::memcmp (a, b, Size) == 0;
+    else
+      {
+        auto pa = static_cast<const unsigned char *> (a);
+        auto pb = static_cast<const unsigned char *> (b);
+        std::uint64_t diff = 0;
+        std::size_t i = 0;
+
+        for (; i + 8 <= Size; i += 8)
+          diff |= detail::hash_load (pa + i) ^ detail::hash_load (pb + i);
+
+        if constexpr (Size % 8 != 0)
+          diff |= detail::hash_load (pa + Size - 8)
+            ^ detail::hash_load (pb + Size - 8);
+
+        return diff == 0;
+      }
+  }
+
+  inline std::uint64_t
+  hash_bytes (const void *data,
+              std::size_t size,
+              std::uint64_t seed = 0)
+    noexcept
+  {
+    auto p = static_cast<const unsigned char *> (data);
+    std::uint64_t a = seed ^ (size * detail::HASH_K1);
+    std::uint64_t b = ~seed;
+
+    for (; size >= 16; p += 16, size -= 16)
+      {
+        a = (a ^ detail::hash_load (p)) * detail::HASH_K1;
+        b = (b ^ detail::hash_load (p + 8)) * detail::HASH_K2;
+        a ^= a >> 29;
+        b ^= b >> 31;
+      }
+
+    if (size >= 8)
+      {
+        a = (a ^ detail::hash_load (p)) * detail::HASH_K1;
+        a ^= a >> 29;
+
+        // The rest, overlapping what was already consumed.
+        if (size > 8)
+          b = (b ^ detail::hash_load (p + size - 8)) * detail::HASH_K2;
+      }
+    else if (size)
+      {
+        std::uint64_t tail = 0;
+        std::memcpy (&tail, p, size);
+        b = (b ^ tail) * detail::HASH_K2;
+      }
+
+    return detail::hash_mix (a ^ (b * detail::HASH_K1));
+  }
+
+  constexpr inline std::uint64_t
+  hash_combine (std::uint64_t seed,
+                std::uint64_t value)
+    noexcept
+  {
+    return detail::hash_mix (seed ^ (value + detail::HASH_K1 + (seed << 6)
+                                     + (seed >> 2)));
+  }
+}
+
+#endif /* __FASTER_CORE_BYTES_HH__ */
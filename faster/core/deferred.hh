@@ -0,0 +1,205 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_DEFERRED_HH__
+#define __FASTER_CORE_DEFERRED_HH__
+
+/*
+ * Deferred updates
+ *
+ * SUMMARY
+ *
+ * A pending_queue belongs to an object owned by a single thread (like an
+ * event loop), but updated from other threads too.  Instead of locking every
+ * access, foreign threads push updates into the queue and the owner applies
+ * them in a batch, usually once per loop iteration.  The owner itself can
+ * then access the object without any synchronization.
+ *
+ * The *_DEFER property variants use it: their setters assign directly when
+ * called by the owner, and push the assignment into the queue otherwise.
+ * Classes with such properties must contain FASTER_PENDING_QUEUE, which
+ * declares the queue, the apply_pending method and the pending_updates
+ * method which returns the queue.
+ *
+ * IMPLEMENTATION
+ *
+ * The queue is a lock-free stack of heap-allocated updates.  Pushing is a
+ * compare-and-swap on its head.  apply takes the whole stack with a single
+ * exchange, reverses it and runs the updates in the order they were pushed,
+ * so the last update of a value wins.
+ *
+ * The owner is the thread which created the queue.  It can be changed using
+ * owner, but not while other threads may be pushing.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace faster::core
+{
+  class pending_queue
+  {
+  public:
+    pending_queue ()
+      noexcept
+      : head_ {nullptr}, owner_ {std::this_thread::get_id ()}
+    {
+    }
+
+    pending_queue (const pending_queue &) = delete;
+    pending_queue &operator= (const pending_queue &) = delete;
+
+    /*
+     * Pending updates are dropped.
+     */
+    ~pending_queue ()
+    {
+      node *n = head_.load (std::memory_order_acquire);
+
+      while (n)
+        delete std::exchange (n, n->next);
+    }
+
+    bool
+    owned ()
+      const noexcept
+    {
+      return std::this_thread::get_id () == owner_;
+    }
+
+    void
+    owner (std::thread::id id)
+      noexcept
+    {
+      owner_ = id;
+    }
+
+    /*
+     * Queues f to be called by apply.  Safe to call from any thread.
+     */
+    template <typename F>
+    void
+    push (F &&f)
+    {
+      node *n = new update<std::decay_t<F>> {std::forward<F> (f)};
+      n->next = head_.load (std::memory_order_relaxed);
+
+      while (!head_.compare_exchange_weak (n->next, n,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+        ;
+    }
+
+    /*
+     * Runs all queued updates, in the order they were pushed.  Returns their
+     * number.  Should be called by the owner.
+     */
+    std::size_t
+    apply ()
+    {
+      node *n = head_.exchange (nullptr, std::memory_order_acquire);
+      node *reversed = nullptr;
+      std::size_t count = 0;
+
+      while (n)
+        {
+          node *next = n->next;
+          n->next = reversed;
+          reversed = n;
+          n = next;
+        }
+
+      while (reversed)
+        {
+          node *next = reversed->next;
+          reversed->run ();
+          delete reversed;
+          reversed = next;
+          count ++;
+        }
+
+      return count;
+    }
+
+  private:
+    struct node
+    {
+      node *next = nullptr;
+
+      virtual
+      ~node ()
+      {
+      }
+
+      virtual void
+      run () = 0;
+    };
+
+    template <typename F>
+    struct update final : node
+    {
+      F f;
+
+      update (F &&function)
+        : f {std::move (function)}
+      {
+      }
+
+      update (const F &function)
+        : f {function}
+      {
+      }
+
+      void
+      run ()
+        override
+      {
+        f ();
+      }
+    };
+
+    std::atomic<node *> head_;
+    std::thread::id owner_;
+  };
+}
+
+/**
+ * Declares the pending queue used by *_DEFER properties, and the
+ * apply_pending method, which applies updates made by other threads.
+ */
+#define FASTER_PENDING_QUEUE \
+  private: \
+  mutable faster::core::pending_queue faster_pending_; \
+  \
+  public: \
+  std::size_t \
+  apply_pending () \
+  { \
+    return faster_pending_.apply (); \
+  } \
+  \
+  public: \
+  faster::core::pending_queue & \
+  pending_updates () const noexcept \
+  { \
+    return faster_pending_; \
+  }
+
+#endif /* __FASTER_CORE_DEFERRED_HH__ */
@@ -0,0 +1,120 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_DOUBLE_BUFFER_HH__
+#define __FASTER_CORE_DOUBLE_BUFFER_HH__
+
+/*
+ * Double buffers
+ *
+ * SUMMARY
+ *
+ * A double buffer hands values (like frames or statistics snapshots) over
+ * from one producer thread to one consumer thread.  The producer fills the
+ * back buffer in place and publishes it, the consumer reads the front buffer,
+ * which is the last published one.  Neither side ever waits for the other,
+ * and nothing is copied or allocated when publishing.
+ *
+ * It backs the *_DBUF property variants, whose nonconst getter and setters
+ * access the back buffer, and whose const getter accesses the front buffer.
+ *
+ * IMPLEMENTATION
+ *
+ * There are actually three buffers: besides the back and front ones, there
+ * is the last published buffer not yet picked up by the consumer.  publish
+ * swaps it with the back buffer, front swaps it with the front buffer if it
+ * is newer.  This is what allows the producer to continue while the consumer
+ * still reads the previous front buffer.
+ *
+ * A consequence is that after publish, the back buffer does not contain the
+ * published value, but an older one.  Producers should overwrite it, not
+ * update it incrementally.
+ *
+ * A reference returned by front is valid until the next call to front.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace faster::core
+{
+  template <typename T>
+  class double_buffer
+  {
+  public:
+    double_buffer ()
+      : buffers_ {}, back_ {0}, front_ {1}, middle_ {2}
+    {
+    }
+
+    explicit
+    double_buffer (const T &value)
+      : buffers_ {value, value, value}, back_ {0}, front_ {1}, middle_ {2}
+    {
+    }
+
+    double_buffer (const double_buffer &) = delete;
+    double_buffer &operator= (const double_buffer &) = delete;
+
+    /*
+     * The buffer being filled.  Only for the producer.
+     */
+    T &
+    back ()
+      noexcept
+    {
+      return buffers_[back_];
+    }
+
+    /*
+     * Makes the back buffer the one the consumer will see next.  Only for the
+     * producer.
+     */
+    void
+    publish ()
+      noexcept
+    {
+      back_ = middle_.exchange (back_ | FRESH, std::memory_order_acq_rel)
+        & INDEX;
+    }
+
+    /*
+     * The last published buffer.  Only for the consumer.
+     */
+    const T &
+    front ()
+      const noexcept
+    {
+      if (middle_.load (std::memory_order_relaxed) & FRESH)
+        front_ = middle_.exchange (front_, std::memory_order_acq_rel) & INDEX;
+
+      return buffers_[front_];
+    }
+
+  private:
+    static constexpr std::uint8_t INDEX = 0x3;
+    static constexpr std::uint8_t FRESH = 0x4;
+
+    T buffers_[3];
+    std::uint8_t back_;
+    mutable std::uint8_t front_;
+    mutable std::atomic<std::uint8_t> middle_;
+  };
+}
+
+#endif /* __FASTER_CORE_DOUBLE_BUFFER_HH__ */
@@ -15,8 +15,19 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 using std::cout;
 
@@ -43,15 +54,66 @@ enum : features
   RWLOCK                 = 0x00010000,
   VOLATILE               = 0x00020000,
   VIRTUAL                = 0x00040000,
-  FEATURES_MAX           = 0x0007FFFF,
+  WAIT                   = 0x00080000,
+  REPLICATED             = 0x00100000,
+  DISTRIBUTED_RWLOCK     = 0x00200000,
+  DEFER                  = 0x00400000,
+  DOUBLE_BUFFER          = 0x00800000,
+  OBSERVABLE             = 0x01000000,
+  ALLOCATOR              = 0x02000000,
+  FEATURES_MAX           = 0x03FFFFFF,
+
+  // The field is a wrapper class, accessed using load and store.
+  WRAPPED                = WAIT | REPLICATED,
 };
 
 namespace
 {
+  struct feature_name
+  {
+    features flag;
+    const char *name;
+  };
+
+  // Macro name suffixes, in the order they appear in macro names.
+  constexpr feature_name feature_names[] = {
+    {ABSTRACT, "AB"},
+    {CUSTOM_FIELD, "CF"},
+    {DETECT_TYPE, "DT"},
+    {EXCEPTIONS, "EX"},
+    {LOCK, "LOCK"},
+    {MUTABLE, "MUTABLE"},
+    {NOT_CONSTEXPR, "NC"},
+    {NO_COPYING, "NCP"},
+    {NO_FIELD, "NF"},
+    {NO_SETTERS, "NS"},
+    {OVERRIDE, "OV"},
+    {PASS_BY_VALUE, "PBV"},
+    {PRIVATE, "PRIV"},
+    {PRIV_SET, "PRIVSET"},
+    {READ_ONLY, "RO"},
+    {REFERENCE, "REF"},
+    {RWLOCK, "RWLOCK"},
+    {VOLATILE, "VOLATILE"},
+    {VIRTUAL, "VT"},
+    {WAIT, "WAIT"},
+    {REPLICATED, "REPLICATED"},
+    {DISTRIBUTED_RWLOCK, "DRWLOCK"},
+    {DEFER, "DEFER"},
+    {DOUBLE_BUFFER, "DBUF"},
+    {OBSERVABLE, "OBS"},
+    {ALLOCATOR, "PMR"},
+  };
+
   constexpr inline bool
   features_valid (features f)
     noexcept
   {
+    // Only the lock type differs from RWLOCK.
+    if (f & DISTRIBUTED_RWLOCK)
+      return !(f & RWLOCK)
+        && features_valid ((f & ~DISTRIBUTED_RWLOCK) | RWLOCK);
+
     if (f & ABSTRACT
         && f & (CUSTOM_FIELD | DETECT_TYPE | LOCK | NOT_CONSTEXPR
                 | NO_FIELD | OVERRIDE | RWLOCK | VOLATILE | VIRTUAL))
@@ -109,9 +171,58 @@ namespace
         && f & VOLATILE)
       return false;
 
+    if (f & WAIT
+        && (f & (ABSTRACT | CUSTOM_FIELD | DETECT_TYPE | LOCK | MUTABLE
+                 | NOT_CONSTEXPR | NO_COPYING | NO_SETTERS | OVERRIDE
+                 | READ_ONLY | REFERENCE | RWLOCK | VIRTUAL | VOLATILE)
+            || !(f & PASS_BY_VALUE)))
+      return false;
+
+    if (f & REPLICATED
+        && f & (ABSTRACT | CUSTOM_FIELD | DETECT_TYPE | LOCK | MUTABLE
+                | NOT_CONSTEXPR | NO_SETTERS | OVERRIDE | READ_ONLY
+                | REFERENCE | RWLOCK | VIRTUAL | VOLATILE | WAIT))
+      return false;
+
+    if (f & DEFER
+        && f & (ABSTRACT | LOCK | NO_SETTERS | OVERRIDE | READ_ONLY
+                | REFERENCE | RWLOCK | VIRTUAL | VOLATILE | WRAPPED))
+      return false;
+
+    if (f & DOUBLE_BUFFER
+        && f & (ABSTRACT | CUSTOM_FIELD | DEFER | DETECT_TYPE | LOCK | MUTABLE
+                | NOT_CONSTEXPR | OVERRIDE | READ_ONLY | REFERENCE | RWLOCK
+                | VIRTUAL | VOLATILE | WRAPPED))
+      return false;
+
+    if (f & OBSERVABLE
+        && f & (ABSTRACT | CUSTOM_FIELD | DEFER | DETECT_TYPE | DOUBLE_BUFFER
+                | LOCK | MUTABLE | NO_COPYING | NO_SETTERS | OVERRIDE
+                | READ_ONLY | REFERENCE | RWLOCK | VIRTUAL | VOLATILE
+                | WRAPPED))
+      return false;
+
+    if (f & ALLOCATOR
+        && f & (ABSTRACT | CUSTOM_FIELD | DEFER | DOUBLE_BUFFER | MUTABLE
+                | NO_SETTERS | OBSERVABLE | OVERRIDE | PASS_BY_VALUE
+                | READ_ONLY | REFERENCE | VIRTUAL | VOLATILE | WRAPPED))
+      return false;
+
     return true;
   }
 
+  // Set by --profile, see <faster/core/profile.hh>.
+  bool profile_accesses = false;
+
+  inline bool
+  accessors_constexpr (features f)
+    noexcept
+  {
+    return !(f & (ABSTRACT | DOUBLE_BUFFER | NOT_CONSTEXPR | OVERRIDE
+                  | WRAPPED))
+      && !profile_accesses;
+  }
+
   inline void
   write_macro_comment (features f)
   {
@@ -183,7 +294,7 @@ namespace
     else
       cout << " * The property accessors are noexcept.\n";
 
-    if (!(f & (ABSTRACT | OVERRIDE | NOT_CONSTEXPR)))
+    if (accessors_constexpr (f))
       cout << " * The property accessors are constexpr.\n";
 
     if (f & LOCK)
@@ -192,9 +303,33 @@ namespace
     else if (f & RWLOCK)
       cout << " * The property has an associated shared lock, accessible "
         "using the <<Name>>_lock method.\n";
+    else if (f & DISTRIBUTED_RWLOCK)
+      cout << " * The property has an associated distributed shared lock, "
+        "accessible using the <<Name>>_lock method.\n";
     else if (f & VOLATILE)
       cout << " * The property is volatile, but does not have an associated "
         "lock.\n";
+    else if (f & WAIT)
+      cout << " * The property is atomic and can be waited on, using the "
+        "<<Name>>_wait and <<Name>>_wait_for methods.\n";
+    else if (f & REPLICATED)
+      cout << " * The property is replicated per NUMA node, getters read the "
+        "local replica.\n";
+    else if (f & DEFER)
+      cout << " * Setters called by threads other than the owner are "
+        "deferred until apply_pending.\n";
+    else if (f & DOUBLE_BUFFER)
+      cout << " * The property is double-buffered, the const getter reads the "
+        "front buffer,\n * other accessors the back buffer, which is made "
+        "the front one using\n * the <<Name>>_publish method.\n";
+    else if (f & OBSERVABLE)
+      cout << " * Changes are delivered to observers, added using the "
+        "<<Name>>_observe method,\n * once per flush_notifications.\n";
+
+    if (f & ALLOCATOR)
+      cout << " * The property uses the memory resource of the object, new "
+        "values can be built\n * on it using the <<Name>>_emplace "
+        "method.\n";
 
     cout << " */\n";
   }
@@ -204,44 +339,9 @@ namespace
   {
     cout << "FASTER_PROPERTY";
 
-    if (f & ABSTRACT)
-      cout << "_AB";
-    if (f & CUSTOM_FIELD)
-      cout << "_CF";
-    if (f & DETECT_TYPE)
-      cout << "_DT";
-    if (f & EXCEPTIONS)
-      cout << "_EX";
-    if (f & LOCK)
-      cout << "_LOCK";
-    if (f & MUTABLE)
-      cout << "_MUTABLE";
-    if (f & NOT_CONSTEXPR)
-      cout << "_NC";
-    if (f & NO_COPYING)
-      cout << "_NCP";
-    if (f & NO_FIELD)
-      cout << "_NF";
-    if (f & NO_SETTERS)
-      cout << "_NS";
-    if (f & OVERRIDE)
-      cout << "_OV";
-    if (f & PASS_BY_VALUE)
-      cout << "_PBV";
-    if (f & PRIVATE)
-      cout << "_PRIV";
-    if (f & PRIV_SET)
-      cout << "_PRIVSET";
-    if (f & READ_ONLY)
-      cout << "_RO";
-    if (f & REFERENCE)
-      cout << "_REF";
-    if (f & RWLOCK)
-      cout << "_RWLOCK";
-    if (f & VOLATILE)
-      cout << "_VOLATILE";
-    if (f & VIRTUAL)
-      cout << "_VT";
+    for (const auto &feature : feature_names)
+      if (f & feature.flag)
+        cout << '_' << feature.name;
   }
 
   inline void
@@ -279,6 +379,35 @@ namespace
       cout << "Type";
   }
 
+  inline void
+  write_profile (const char *access)
+  {
+    if (!profile_accesses)
+      return;
+
+    cout << "    static faster::core::profile_site Name##_profile_site "
+      "{__PRETTY_FUNCTION__, #Name}; \\\n";
+    cout << "    Name##_profile_site." << access << " (); \\\n";
+  }
+
+  // The target of assignments in setters.  When profiling, setters count the
+  // write themselves, so they assign the field directly instead of through
+  // the (also counting) nonconst getter, unless it may be overridden.
+  inline void
+  write_setter_target (features f)
+  {
+    if (!profile_accesses || f & (ABSTRACT | OVERRIDE | VIRTUAL))
+      {
+        cout << "Name ()";
+        return;
+      }
+
+    write_field (f);
+
+    if (f & DOUBLE_BUFFER)
+      cout << ".back ()";
+  }
+
   inline void
   begin_item (bool &first_item)
   {
@@ -290,31 +419,68 @@ namespace
   }
 
   inline void
-  declare_field (features f,
-                 bool &first_item)
+  write_field_declaration (features f,
+                           const char *type,
+                           const char *field)
   {
-    if (f & (ABSTRACT | CUSTOM_FIELD | NO_FIELD))
-      return;
+    if (f & WAIT)
+      {
+        cout << "faster::core::waitable<" << type << "> " << field;
+        return;
+      }
 
-    begin_item (first_item);
+    if (f & REPLICATED)
+      {
+        cout << "faster::core::replicated<" << type << "> " << field;
+        return;
+      }
 
-    cout << "  private: \\\n"
-      << "  ";
+    if (f & DOUBLE_BUFFER)
+      {
+        cout << "faster::core::double_buffer<" << type << "> " << field;
+        return;
+      }
 
     if (f & MUTABLE)
       cout << "mutable ";
 
-    if (f & DETECT_TYPE)
-      cout << "decltype (Name##_) ";
-    else
-      cout << "Type ";
+    cout << type << ' ';
 
     if (f & VOLATILE)
       cout << "volatile ";
     if (f & READ_ONLY)
       cout << "const ";
 
-    cout << "Name##_;";
+    cout << field;
+  }
+
+  inline void
+  declare_field (features f,
+                 bool &first_item)
+  {
+    if (f & (ABSTRACT | CUSTOM_FIELD | NO_FIELD))
+      return;
+
+    begin_item (first_item);
+
+    cout << "  private: \\\n"
+      << "  ";
+
+    write_field_declaration (f,
+                             f & DETECT_TYPE ? "decltype (Name##_)" : "Type",
+                             "Name##_");
+
+    // Not braces, which would prefer initializer_list constructors, like the
+    // one of std::pmr::vector<const void *>.
+    if (f & ALLOCATOR)
+      {
+        cout << " = ";
+        write_type (f);
+        cout << " (std::pmr::polymorphic_allocator<std::byte> "
+          "(faster_memory_resource ()))";
+      }
+
+    cout << ';';
   }
 
   inline void
@@ -333,7 +499,7 @@ namespace
 
     cout << "  ";
 
-    if (!(f & (ABSTRACT | NOT_CONSTEXPR | OVERRIDE)))
+    if (accessors_constexpr (f))
       cout << "constexpr ";
 
     if (f & (ABSTRACT | VIRTUAL))
@@ -341,7 +507,7 @@ namespace
 
     write_type (f);
 
-    if (!(f & (PASS_BY_VALUE | REFERENCE)))
+    if (!(f & (PASS_BY_VALUE | REFERENCE | REPLICATED)))
       {
         cout << " const";
 
@@ -368,8 +534,13 @@ namespace
       {
         cout << " \\\n";
         cout << "  { \\\n";
+        write_profile ("read");
         cout << "    return ";
         write_field (f);
+        if (f & WRAPPED)
+          cout << ".load ()";
+        else if (f & DOUBLE_BUFFER)
+          cout << ".front ()";
         cout << "; \\\n";
         cout << "  }";
       }
@@ -379,7 +550,7 @@ namespace
   declare_nonconst_getter (features f,
                            bool &first_item)
   {
-    if (f & (READ_ONLY | REFERENCE))
+    if (f & (OBSERVABLE | READ_ONLY | REFERENCE | WRAPPED))
       return;
 
     begin_item (first_item);
@@ -391,7 +562,7 @@ namespace
 
     cout << "  ";
 
-    if (!(f & (ABSTRACT | NOT_CONSTEXPR | OVERRIDE)))
+    if (accessors_constexpr (f))
       cout << "constexpr ";
 
     if (f & (ABSTRACT | VIRTUAL))
@@ -424,8 +595,11 @@ namespace
       {
         cout << " \\\n";
         cout << "  { \\\n";
+        write_profile ("mutable_access");
         cout << "    return ";
         write_field (f);
+        if (f & DOUBLE_BUFFER)
+          cout << ".back ()";
         cout << "; \\\n";
         cout << "  }";
       }
@@ -468,7 +642,32 @@ namespace
 
     cout << " \\\n";
     cout << "  { \\\n";
-    cout << "    Name () = Name##_new_value; \\\n";
+    write_profile ("write");
+    if (f & WRAPPED)
+      cout << "    Name##_.store (Name##_new_value); \\\n";
+    else if (f & OBSERVABLE)
+      cout << "    Name##_observers_.set (faster_notifications_, Name##_, \\\n"
+        "                           Name##_new_value); \\\n";
+    else if (f & DEFER)
+      {
+        cout << "    if (faster_pending_.owned ()) \\\n";
+        cout << "      ";
+        write_setter_target (f);
+        cout << " = Name##_new_value; \\\n";
+        cout << "    else \\\n";
+        cout << "      faster_pending_.push ([this, Name##_new_value] () \\\n";
+        cout << "        { \\\n";
+        cout << "          ";
+        write_setter_target (f);
+        cout << " = Name##_new_value; \\\n";
+        cout << "        }); \\\n";
+      }
+    else
+      {
+        cout << "    ";
+        write_setter_target (f);
+        cout << " = Name##_new_value; \\\n";
+      }
     cout << "  }";
   }
 
@@ -501,21 +700,51 @@ namespace
 
     cout << " \\\n";
     cout << "  { \\\n";
-    cout << "    Name () = std::move (Name##_new_value); \\\n";
+    write_profile ("write");
+    if (f & WRAPPED)
+      cout << "    Name##_.store (std::move (Name##_new_value)); \\\n";
+    else if (f & OBSERVABLE)
+      cout << "    Name##_observers_.set (faster_notifications_, Name##_, \\\n"
+        "                           std::move (Name##_new_value)); \\\n";
+    else if (f & DEFER)
+      {
+        cout << "    if (faster_pending_.owned ()) \\\n";
+        cout << "      ";
+        write_setter_target (f);
+        cout << " = std::move (Name##_new_value); \\\n";
+        cout << "    else \\\n";
+        cout << "      faster_pending_.push ( \\\n";
+        cout << "        [this, Name##_deferred_value \\\n";
+        cout << "                 = std::move (Name##_new_value)] () mutable "
+          "\\\n";
+        cout << "        { \\\n";
+        cout << "          ";
+        write_setter_target (f);
+        cout << " = std::move (Name##_deferred_value); \\\n";
+        cout << "        }); \\\n";
+      }
+    else
+      {
+        cout << "    ";
+        write_setter_target (f);
+        cout << " = std::move (Name##_new_value); \\\n";
+      }
     cout << "  }";
   }
 
   inline constexpr const char *
   lock_class (features f)
   {
-    return f & LOCK ? "std::mutex" : "std::shared_mutex";
+    return f & LOCK ? "std::mutex"
+      : f & RWLOCK ? "std::shared_mutex"
+      : "faster::core::distributed_shared_mutex";
   }
 
   inline void
   declare_lock (features f,
                 bool &first_item)
   {
-    if (!(f & (LOCK | RWLOCK)))
+    if (!(f & (LOCK | RWLOCK | DISTRIBUTED_RWLOCK)))
       return;
 
     begin_item (first_item);
@@ -541,6 +770,119 @@ namespace
     cout << "  }";
   }
 
+  inline void
+  declare_wait (features f,
+                bool &first_item)
+  {
+    if (!(f & WAIT))
+      return;
+
+    begin_item (first_item);
+
+    if (f & PRIVATE)
+      cout << "  private: \\\n";
+    else
+      cout << "  public: \\\n";
+
+    cout << "  void \\\n";
+    cout << "  Name##_wait (Type Name##_old_value) const noexcept \\\n";
+    cout << "  { \\\n";
+    cout << "    Name##_.wait (Name##_old_value); \\\n";
+    cout << "  } \\\n";
+    cout << "  \\\n";
+    cout << "  template <typename Name##_pred_type, typename Name##_rep_type, "
+      "\\\n";
+    cout << "            typename Name##_period_type> \\\n";
+    cout << "  bool \\\n";
+    cout << "  Name##_wait_for (Name##_pred_type Name##_pred, \\\n";
+    cout << "                   const std::chrono::duration<Name##_rep_type, "
+      "\\\n";
+    cout << "                                               "
+      "Name##_period_type> \\\n";
+    cout << "                     &Name##_timeout) const \\\n";
+    cout << "  { \\\n";
+    cout << "    return Name##_.wait_for (Name##_pred, Name##_timeout); \\\n";
+    cout << "  }";
+  }
+
+  inline void
+  declare_publish (features f,
+                   bool &first_item)
+  {
+    if (!(f & DOUBLE_BUFFER))
+      return;
+
+    begin_item (first_item);
+
+    if (f & (PRIVATE | PRIV_SET))
+      cout << "  private: \\\n";
+    else
+      cout << "  public: \\\n";
+
+    cout << "  void \\\n";
+    cout << "  Name##_publish () noexcept \\\n";
+    cout << "  { \\\n";
+    cout << "    Name##_.publish (); \\\n";
+    cout << "  }";
+  }
+
+  inline void
+  declare_observe (features f,
+                   bool &first_item)
+  {
+    if (!(f & OBSERVABLE))
+      return;
+
+    begin_item (first_item);
+
+    cout << "  private: \\\n";
+    cout << "  faster::core::observers<Type> Name##_observers_; \\\n";
+
+    if (f & PRIVATE)
+      cout << "  private: \\\n";
+    else
+      cout << "  public: \\\n";
+
+    cout << "  void \\\n";
+    cout << "  Name##_observe (faster::core::observer<Type> Name##_observer) "
+      "\\\n";
+    cout << "  { \\\n";
+    cout << "    Name##_observers_.add (faster_notifications_, \\\n";
+    cout << "                           std::move (Name##_observer)); \\\n";
+    cout << "  }";
+  }
+
+  inline void
+  declare_emplace (features f,
+                   bool &first_item)
+  {
+    if (!(f & ALLOCATOR))
+      return;
+
+    begin_item (first_item);
+
+    if (f & (PRIVATE | PRIV_SET))
+      cout << "  private: \\\n";
+    else
+      cout << "  public: \\\n";
+
+    cout << "  template <typename... Name##_arg_types> \\\n";
+    cout << "  void \\\n";
+    cout << "  Name##_emplace (Name##_arg_types &&...Name##_args)";
+
+    if (!(f & EXCEPTIONS))
+      cout << " noexcept";
+
+    cout << " \\\n";
+    cout << "  { \\\n";
+    write_profile ("write");
+    cout << "    Name##_ = ";
+    write_type (f);
+    cout << " (std::forward<Name##_arg_types> (Name##_args)..., \\\n";
+    cout << "                    Name##_.get_allocator ()); \\\n";
+    cout << "  }";
+  }
+
   inline void
   declare_macro (features f)
   {
@@ -558,6 +900,10 @@ namespace
     declare_setter (f, first_item);
     declare_move_setter (f, first_item);
     declare_lock (f, first_item);
+    declare_wait (f, first_item);
+    declare_publish (f, first_item);
+    declare_observe (f, first_item);
+    declare_emplace (f, first_item);
 
     cout << '\n';
   }
@@ -571,11 +917,953 @@ namespace
     declare_macro (f);
     cout << '\n';
   }
+
+  /*
+   * Schema mode
+   *
+   * Instead of the macro definitions, a whole class can be generated from a
+   * schema file.  Its fields are laid out to minimize padding, with hot
+   * fields first, while the accessors are the same as if the properties were
+   * declared using the macros in declaration order.  Each line of the schema
+   * is one directive, # starts a comment and double quotes group words:
+   *
+   *   class NAME
+   *   namespace NAME
+   *   include <HEADER>|"HEADER"
+   *   generate equality|hash
+   *   property NAME TYPE [FEATURE...] [hot|cold] [default=VALUE]
+   *            [size=N align=N]
+   *
+   * Headers are included just like written, in angle brackets or in
+   * quotes.  FEATURE is a macro name suffix without the underscore (like PBV
+   * or LOCK).  The sizes of fundamental and some standard types are known,
+   * other types need size= and align=.  The generated header checks all
+   * these assumptions using static_assert.
+   *
+   * "generate equality" adds operator== and operator!=, "generate hash" adds
+   * a hash method and a hasher member type.  Both treat adjacent PBV fields
+   * of known integral or pointer types without padding in between as one run
+   * of raw bytes, compared and hashed by faster::core::equal_bytes and
+   * hash_bytes.  Other fields are handled one by one, using their own == and
+   * std::hash: floating point equality is not bitwise, and other types may
+   * contain padding.  Locks do not take part.
+   */
+
+  constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  struct schema_error
+  {
+    std::size_t line;
+    std::string message;
+  };
+
+  struct known_type
+  {
+    const char *name;
+    std::size_t size;
+    std::size_t align;
+    // Equal values have equal bytes, there is no padding.
+    bool bytewise;
+  };
+
+#define KNOWN_TYPE(T) \
+  {#T, sizeof (T), alignof (T), std::is_integral_v<T>}
+
+  const known_type known_types[] = {
+    KNOWN_TYPE (bool),
+    KNOWN_TYPE (char),
+    KNOWN_TYPE (signed char),
+    KNOWN_TYPE (unsigned char),
+    KNOWN_TYPE (wchar_t),
+    KNOWN_TYPE (char16_t),
+    KNOWN_TYPE (char32_t),
+    KNOWN_TYPE (short),
+    KNOWN_TYPE (unsigned short),
+    KNOWN_TYPE (int),
+    KNOWN_TYPE (unsigned),
+    KNOWN_TYPE (unsigned int),
+    KNOWN_TYPE (long),
+    KNOWN_TYPE (unsigned long),
+    KNOWN_TYPE (long long),
+    KNOWN_TYPE (unsigned long long),
+    KNOWN_TYPE (float),
+    KNOWN_TYPE (double),
+    KNOWN_TYPE (long double),
+    KNOWN_TYPE (std::int8_t),
+    KNOWN_TYPE (std::int16_t),
+    KNOWN_TYPE (std::int32_t),
+    KNOWN_TYPE (std::int64_t),
+    KNOWN_TYPE (std::uint8_t),
+    KNOWN_TYPE (std::uint16_t),
+    KNOWN_TYPE (std::uint32_t),
+    KNOWN_TYPE (std::uint64_t),
+    KNOWN_TYPE (std::size_t),
+    KNOWN_TYPE (std::ptrdiff_t),
+    KNOWN_TYPE (std::intptr_t),
+    KNOWN_TYPE (std::uintptr_t),
+    KNOWN_TYPE (std::string),
+    KNOWN_TYPE (std::string_view),
+  };
+
+#undef KNOWN_TYPE
+
+  enum temperature : int
+  {
+    COLD = -1,
+    NORMAL = 0,
+    HOT = 1,
+  };
+
+  struct schema_property
+  {
+    std::string name;
+    std::string type;
+    features f = 0;
+    temperature temp = NORMAL;
+    std::string init;
+    std::size_t size = 0;
+    std::size_t align = 0;
+  };
+
+  struct schema
+  {
+    std::string class_name;
+    std::string namespace_name;
+    std::vector<std::string> includes;
+    std::vector<schema_property> properties;
+    bool equality = false;
+    bool hash = false;
+  };
+
+  // One data member of the generated class.
+  struct schema_member
+  {
+    const schema_property *property;
+    bool lock;
+    std::string name;
+    std::string type;
+    std::size_t size;
+    std::size_t align;
+  };
+
+  struct placed_member
+  {
+    const schema_member *member;
+    std::size_t offset;
+  };
+
+  struct class_layout
+  {
+    std::vector<placed_member> members;
+    std::size_t size;
+    std::size_t padding;
+  };
+
+  inline std::vector<std::string>
+  tokenize (const std::string &line,
+            std::size_t line_number)
+  {
+    std::vector<std::string> tokens;
+    std::string token;
+    bool in_token = false;
+    bool quoted = false;
+
+    for (std::size_t i = 0; i < line.size (); i ++)
+      {
+        char c = line[i];
+
+        if (quoted)
+          {
+            if (c == '\\' && i + 1 < line.size ())
+              token += line[++ i];
+            else if (c == '"')
+              quoted = false;
+            else
+              token += c;
+          }
+        else if (c == '"')
+          in_token = quoted = true;
+        else if (c == '#')
+          break;
+        else if (c == ' ' || c == '\t' || c == '\r')
+          {
+            if (in_token)
+              tokens.push_back (std::move (token));
+            token.clear ();
+            in_token = false;
+          }
+        else
+          {
+            token += c;
+            in_token = true;
+          }
+      }
+
+    if (quoted)
+      throw schema_error {line_number, "unterminated quote"};
+
+    if (in_token)
+      tokens.push_back (std::move (token));
+
+    return tokens;
+  }
+
+  inline std::string
+  normalize_type (const std::string &type)
+  {
+    std::string result;
+
+    for (char c : type)
+      if (c == ' ' || c == '\t')
+        {
+          if (!result.empty () && result.back () != ' ')
+            result += ' ';
+        }
+      else
+        result += c;
+
+    while (!result.empty () && result.back () == ' ')
+      result.pop_back ();
+
+    return result;
+  }
+
+  inline std::size_t
+  parse_size (const std::string &value,
+              std::size_t line_number)
+  {
+    std::size_t result = 0;
+
+    if (value.empty ())
+      throw schema_error {line_number, "expected a number"};
+
+    for (char c : value)
+      if (c >= '0' && c <= '9')
+        result = result * 10 + (c - '0');
+      else
+        throw schema_error {line_number, "invalid number: " + value};
+
+    return result;
+  }
+
+  inline bool
+  starts_with (const std::string &s,
+               const char *prefix)
+  {
+    return s.compare (0, std::strlen (prefix), prefix) == 0;
+  }
+
+  inline void
+  resolve_type_size (schema_property &p,
+                     std::size_t line_number)
+  {
+    if (p.size)
+      {
+        if (!p.align || p.align & (p.align - 1))
+          throw schema_error {line_number,
+                              "size= needs a power of two align="};
+        return;
+      }
+
+    if (p.align)
+      throw schema_error {line_number, "align= needs size="};
+
+    if (!p.type.empty () && p.type.back () == '*')
+      {
+        p.size = sizeof (void *);
+        p.align = alignof (void *);
+        return;
+      }
+
+    for (const auto &type : known_types)
+      if (p.type == type.name)
+        {
+          p.size = type.size;
+          p.align = type.align;
+          return;
+        }
+
+    throw schema_error {line_number,
+                        "unknown size of type " + p.type
+                        + ", specify size= and align="};
+  }
+
+  inline schema_property
+  parse_property (const std::vector<std::string> &tokens,
+                  std::size_t line_number)
+  {
+    if (tokens.size () < 3)
+      throw schema_error {line_number, "expected: property NAME TYPE ..."};
+
+    schema_property p;
+    p.name = tokens[1];
+    p.type = normalize_type (tokens[2]);
+
+    for (std::size_t i = 3; i < tokens.size (); i ++)
+      {
+        const std::string &token = tokens[i];
+
+        if (token == "hot")
+          p.temp = HOT;
+        else if (token == "cold")
+          p.temp = COLD;
+        else if (starts_with (token, "default="))
+          p.init = token.substr (8);
+        else if (starts_with (token, "size="))
+          p.size = parse_size (token.substr (5), line_number);
+        else if (starts_with (token, "align="))
+          p.align = parse_size (token.substr (6), line_number);
+        else
+          {
+            const feature_name *found = nullptr;
+
+            for (const auto &feature : feature_names)
+              if (token == feature.name)
+                found = &feature;
+
+            if (!found)
+              throw schema_error {line_number, "unknown feature: " + token};
+
+            p.f |= found->flag;
+          }
+      }
+
+    constexpr features forbidden = ABSTRACT | ALLOCATOR | CUSTOM_FIELD
+      | DEFER | DETECT_TYPE | DOUBLE_BUFFER | NO_FIELD | OBSERVABLE
+      | OVERRIDE | REFERENCE | VIRTUAL;
+
+    if (p.f & forbidden || !features_valid (p.f | NO_FIELD))
+      throw schema_error {line_number,
+                          "unsupported feature combination for property "
+                          + p.name};
+
+    resolve_type_size (p, line_number);
+    return p;
+  }
+
+  inline schema
+  parse_schema (std::istream &in)
+  {
+    schema result;
+    std::string line;
+    std::size_t line_number = 0;
+
+    while (std::getline (in, line))
+      {
+        line_number ++;
+
+        auto tokens = tokenize (line, line_number);
+
+        if (tokens.empty ())
+          continue;
+
+        const std::string &directive = tokens[0];
+
+        if (directive == "property")
+          result.properties.push_back (parse_property (tokens, line_number));
+        else if (tokens.size () != 2)
+          throw schema_error {line_number,
+                              "expected: " + directive + " VALUE"};
+        else if (directive == "class")
+          result.class_name = tokens[1];
+        else if (directive == "namespace")
+          result.namespace_name = tokens[1];
+        else if (directive == "include")
+          {
+            const std::string &header = tokens[1];
+
+            // The quotes have been eaten by tokenize.
+            if (header.empty ())
+              throw schema_error {line_number, "empty header name"};
+            else if (header.front () == '<' || header.front () == '"')
+              result.includes.push_back (header);
+            else
+              result.includes.push_back ('"' + header + '"');
+          }
+        else if (directive == "generate" && tokens[1] == "equality")
+          result.equality = true;
+        else if (directive == "generate" && tokens[1] == "hash")
+          result.hash = true;
+        else if (directive == "generate")
+          throw schema_error {line_number, "cannot generate " + tokens[1]};
+        else
+          throw schema_error {line_number, "unknown directive: " + directive};
+      }
+
+    if (result.class_name.empty ())
+      throw schema_error {line_number, "missing class directive"};
+
+    return result;
+  }
+
+  inline std::size_t
+  align_up (std::size_t value,
+            std::size_t align)
+  {
+    return (value + align - 1) / align * align;
+  }
+
+  inline schema_member
+  field_member (const schema_property &p)
+  {
+    if (p.f & REPLICATED)
+      {
+        // Mirrors faster::core::replicated: three pointer-sized members
+        // and a std::mutex.
+        std::size_t align = std::max (alignof (void *), alignof (std::mutex));
+        std::size_t size = align_up (3 * sizeof (void *)
+                                     + sizeof (std::mutex), align);
+
+        return {&p, false, p.name + "_",
+                "faster::core::replicated<" + p.type + ">", size, align};
+      }
+
+    if (!(p.f & WAIT))
+      return {&p, false, p.name + "_", p.type, p.size, p.align};
+
+    // Mirrors faster::core::waitable: std::atomic<T>, then a 32-bit word.
+    std::size_t atomic_align = p.align;
+
+    if (p.size <= 16 && !(p.size & (p.size - 1)))
+      atomic_align = std::max (p.align, p.size);
+
+    std::size_t align = std::max (atomic_align, sizeof (std::uint32_t));
+    std::size_t size = align_up (align_up (p.size, sizeof (std::uint32_t))
+                                 + sizeof (std::uint32_t), align);
+
+    return {&p, false, p.name + "_",
+            "faster::core::waitable<" + p.type + ">", size, align};
+  }
+
+  inline std::vector<schema_member>
+  schema_members (const schema &sc)
+  {
+    std::vector<schema_member> members;
+
+    for (const auto &p : sc.properties)
+      {
+        members.push_back (field_member (p));
+
+        if (p.f & LOCK)
+          members.push_back ({&p, true, p.name + "_lock_", "std::mutex",
+                              sizeof (std::mutex), alignof (std::mutex)});
+        else if (p.f & RWLOCK)
+          members.push_back ({&p, true, p.name + "_lock_",
+                              "std::shared_mutex",
+                              sizeof (std::shared_mutex),
+                              alignof (std::shared_mutex)});
+        else if (p.f & DISTRIBUTED_RWLOCK)
+          {
+            // Mirrors faster::core::distributed_shared_mutex: two
+            // pointer-sized members, a std::mutex and a flag.
+            std::size_t align = std::max (alignof (void *),
+                                          alignof (std::mutex));
+            std::size_t size = align_up (2 * sizeof (void *)
+                                         + sizeof (std::mutex) + 1, align);
+
+            members.push_back ({&p, true, p.name + "_lock_",
+                                "faster::core::distributed_shared_mutex",
+                                size, align});
+          }
+      }
+
+    return members;
+  }
+
+  inline class_layout
+  compute_layout (const std::vector<const schema_member *> &order)
+  {
+    class_layout layout {{}, 0, 0};
+    std::size_t offset = 0;
+    std::size_t max_align = 1;
+    std::size_t used = 0;
+
+    for (const schema_member *m : order)
+      {
+        offset = align_up (offset, m->align);
+        layout.members.push_back ({m, offset});
+        offset += m->size;
+        used += m->size;
+        max_align = std::max (max_align, m->align);
+      }
+
+    layout.size = std::max<std::size_t> (align_up (offset, max_align), 1);
+    layout.padding = layout.size - used;
+    return layout;
+  }
+
+  inline std::vector<const schema_member *>
+  optimized_order (const std::vector<schema_member> &members)
+  {
+    std::vector<const schema_member *> sorted;
+
+    for (const auto &m : members)
+      sorted.push_back (&m);
+
+    // Hot members first, cold ones last.  Within each group, decreasing
+    // alignment leaves no holes, as sizes are multiples of alignments.
+    std::stable_sort (sorted.begin (), sorted.end (),
+                      [] (const schema_member *a, const schema_member *b)
+                      {
+                        if (a->property->temp != b->property->temp)
+                          return a->property->temp > b->property->temp;
+                        return a->align > b->align;
+                      });
+
+    // Holes remain between the groups.  Fill them with later members that
+    // fit, even if that moves them into a hotter group: they only take space
+    // which would be wasted anyway.  Prefer members which need no padding
+    // themselves, then larger ones.
+    std::vector<const schema_member *> order;
+    std::vector<bool> placed (sorted.size (), false);
+    std::size_t offset = 0;
+
+    for (std::size_t i = 0; i < sorted.size (); i ++)
+      {
+        if (placed[i])
+          continue;
+
+        std::size_t target = align_up (offset, sorted[i]->align);
+
+        while (offset < target)
+          {
+            std::size_t best = sorted.size ();
+            std::size_t best_start = 0;
+
+            for (std::size_t j = i + 1; j < sorted.size (); j ++)
+              {
+                std::size_t start = align_up (offset, sorted[j]->align);
+
+                if (placed[j] || start + sorted[j]->size > target)
+                  continue;
+
+                if (best == sorted.size ()
+                    || start < best_start
+                    || (start == best_start
+                        && sorted[j]->size > sorted[best]->size))
+                  {
+                    best = j;
+                    best_start = start;
+                  }
+              }
+
+            if (best == sorted.size ())
+              break;
+
+            placed[best] = true;
+            order.push_back (sorted[best]);
+            offset = align_up (offset, sorted[best]->align)
+              + sorted[best]->size;
+          }
+
+        placed[i] = true;
+        order.push_back (sorted[i]);
+        offset = target + sorted[i]->size;
+      }
+
+    return order;
+  }
+
+  inline void
+  write_layout_report (const char *title,
+                       const class_layout &layout)
+  {
+    cout << "// " << title << ": " << layout.size << " bytes, "
+      << layout.padding << " bytes of padding, "
+      << align_up (layout.size, CACHE_LINE_SIZE) / CACHE_LINE_SIZE
+      << " cache line(s)\n";
+    cout << "//\n";
+    cout << "//   line  offset    size  member\n";
+
+    std::size_t offset = 0;
+    char buffer[80];
+
+    auto row = [&buffer] (std::size_t off, std::size_t size,
+                          const std::string &what)
+      {
+        std::snprintf (buffer, sizeof buffer, "//   %4zu  %6zu  %6zu  ",
+                       off / CACHE_LINE_SIZE, off, size);
+        cout << buffer << what << '\n';
+      };
+
+    for (const auto &pm : layout.members)
+      {
+        if (pm.offset > offset)
+          row (offset, pm.offset - offset, "(padding)");
+
+        std::string what = pm.member->name;
+
+        if (pm.member->property->temp == HOT)
+          what += " (hot)";
+        else if (pm.member->property->temp == COLD)
+          what += " (cold)";
+
+        row (pm.offset, pm.member->size, what);
+        offset = pm.offset + pm.member->size;
+      }
+
+    if (layout.size > offset)
+      row (offset, layout.size - offset, "(padding)");
+
+    for (const auto &pm : layout.members)
+      if (pm.member->property->temp == HOT
+          && pm.offset + pm.member->size > CACHE_LINE_SIZE)
+        {
+          cout << "//\n";
+          cout << "// Warning: the hot members do not fit into the first "
+            "cache line.\n";
+          break;
+        }
+
+    cout << "//\n";
+  }
+
+  // A run of fields handled together: either adjacent bytewise comparable
+  // fields, or a single other field.
+  struct field_run
+  {
+    const schema_member *first;
+    std::size_t bytes;
+    std::size_t count;
+  };
+
+  inline bool
+  bytewise_comparable (const schema_property &p)
+  {
+    if (!(p.f & PASS_BY_VALUE) || p.f & (VOLATILE | WRAPPED))
+      return false;
+
+    if (!p.type.empty () && p.type.back () == '*')
+      return true;
+
+    // User types (with size=) may have padding, or their own ==.
+    for (const auto &type : known_types)
+      if (p.type == type.name)
+        return type.bytewise;
+
+    return false;
+  }
+
+  inline std::vector<field_run>
+  field_runs (const class_layout &layout)
+  {
+    std::vector<field_run> runs;
+    bool extendable = false;
+    std::size_t end = 0;
+
+    for (const auto &pm : layout.members)
+      {
+        if (pm.member->lock)
+          {
+            extendable = false;
+            continue;
+          }
+
+        bool bytewise = bytewise_comparable (*pm.member->property);
+
+        if (bytewise && extendable && pm.offset == end)
+          {
+            runs.back ().bytes += pm.member->size;
+            runs.back ().count ++;
+          }
+        else
+          runs.push_back ({pm.member, pm.member->size, 1});
+
+        extendable = bytewise;
+        end = pm.offset + pm.member->size;
+      }
+
+    // Bytewise runs go first, they are cheap and reject early.
+    std::stable_partition (runs.begin (), runs.end (),
+                           [] (const field_run &run)
+                           {
+                             return run.count > 1;
+                           });
+
+    return runs;
+  }
+
+  inline std::string
+  field_value (const schema_member &m,
+               const char *object)
+  {
+    std::string result = object;
+    result += m.name;
+
+    if (m.property->f & WRAPPED)
+      result += ".load ()";
+
+    return result;
+  }
+
+  inline void
+  write_schema_equality (const schema &sc,
+                         const std::vector<field_run> &runs)
+  {
+    cout << "public:\n";
+    cout << "  bool\n";
+    cout << "  operator== (const " << sc.class_name << " &other) const\n";
+    cout << "  {\n";
+    cout << "    return";
+
+    if (runs.empty ())
+      cout << " true";
+
+    for (const auto &run : runs)
+      {
+        if (&run == &runs.front ())
+          cout << ' ';
+        else
+          cout << "\n      && ";
+
+        if (run.count > 1)
+          cout << "faster::core::equal_bytes<" << run.bytes << "> (&"
+            << run.first->name << ", &other." << run.first->name << ")";
+        else
+          cout << field_value (*run.first, "") << " == "
+            << field_value (*run.first, "other.");
+      }
+
+    cout << ";\n";
+    cout << "  }\n";
+    cout << '\n';
+    cout << "  bool\n";
+    cout << "  operator!= (const " << sc.class_name << " &other) const\n";
+    cout << "  {\n";
+    cout << "    return !(*this == other);\n";
+    cout << "  }\n";
+  }
+
+  inline void
+  write_schema_hash (const schema &sc,
+                     const std::vector<field_run> &runs)
+  {
+    cout << "public:\n";
+    cout << "  std::size_t\n";
+    cout << "  hash () const noexcept\n";
+    cout << "  {\n";
+    cout << "    std::uint64_t h = 0;\n";
+
+    for (const auto &run : runs)
+      {
+        cout << "    h = ";
+
+        if (run.count > 1)
+          cout << "faster::core::hash_bytes (&" << run.first->name << ", "
+            << run.bytes << ", h);\n";
+        else
+          cout << "faster::core::hash_combine (h, std::hash<"
+            << run.first->property->type << "> {} ("
+            << field_value (*run.first, "") << "));\n";
+      }
+
+    cout << "    return h;\n";
+    cout << "  }\n";
+    cout << '\n';
+    cout << "  struct hasher\n";
+    cout << "  {\n";
+    cout << "    std::size_t\n";
+    cout << "    operator() (const " << sc.class_name
+      << " &value) const noexcept\n";
+    cout << "    {\n";
+    cout << "      return value.hash ();\n";
+    cout << "    }\n";
+    cout << "  };\n";
+  }
+
+  inline void
+  write_schema_macro (const schema_property &p)
+  {
+    cout << "  ";
+    write_macro_name (p.f | NO_FIELD);
+    cout << " (" << p.name << ", " << p.type << ")\n";
+  }
+
+  inline void
+  write_schema_class (const schema &sc,
+                      const char *source)
+  {
+    auto members = schema_members (sc);
+
+    std::vector<const schema_member *> declared;
+
+    for (const auto &m : members)
+      declared.push_back (&m);
+
+    auto order = optimized_order (members);
+    auto before = compute_layout (declared);
+    auto after = compute_layout (order);
+
+    const char *base = std::strrchr (source, '/');
+    base = base ? base + 1 : source;
+
+    cout << "// Generated from " << base << " by gen_property.\n";
+    cout << "// Do not edit this file! Edit the schema instead.\n";
+    cout << "//\n";
+
+    write_layout_report ("Layout in declaration order", before);
+    write_layout_report ("Generated layout", after);
+
+    std::string guard = "__FASTER_SCHEMA_";
+
+    for (const auto &part : {sc.namespace_name, sc.class_name})
+      if (!part.empty ())
+        {
+          for (char c : part)
+            guard += c >= 'a' && c <= 'z' ? c - 'a' + 'A'
+              : (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ? c : '_';
+          guard += '_';
+        }
+
+    guard += "HH__";
+
+    cout << '\n';
+    cout << "#ifndef " << guard << '\n';
+    cout << "#define " << guard << '\n';
+    cout << '\n';
+
+    features all = 0;
+
+    for (const auto &p : sc.properties)
+      all |= p.f;
+
+    if (sc.hash)
+      {
+        cout << "#include <cstddef>\n";
+        cout << "#include <cstdint>\n";
+        cout << "#include <functional>\n";
+      }
+    if (all & LOCK)
+      cout << "#include <mutex>\n";
+    if (all & RWLOCK)
+      cout << "#include <shared_mutex>\n";
+
+    if (sc.equality || sc.hash)
+      cout << "#include <faster/core/bytes.hh>\n";
+    cout << "#include <faster/core/property.hh>\n";
+
+    if (all & REPLICATED)
+      cout << "#include <faster/core/replicated.hh>\n";
+    if (all & DISTRIBUTED_RWLOCK)
+      cout << "#include <faster/core/shared_mutex.hh>\n";
+    if (all & WAIT)
+      cout << "#include <faster/core/waitable.hh>\n";
+
+    for (const auto &header : sc.includes)
+      cout << "#include " << header << '\n';
+
+    cout << '\n';
+
+    if (!sc.namespace_name.empty ())
+      cout << "namespace " << sc.namespace_name << "\n{\n";
+
+    cout << "class " << sc.class_name << '\n';
+    cout << "{\n";
+
+    // Fields come in the optimized order.  The accessor macro of a property
+    // goes right after its field, or where its lock should be placed.
+    for (const schema_member *m : order)
+      {
+        const schema_property &p = *m->property;
+
+        if (m->lock)
+          {
+            write_schema_macro (p);
+            continue;
+          }
+
+        cout << "private:\n";
+        cout << "  ";
+        write_field_declaration (p.f, p.type.c_str (), m->name.c_str ());
+        cout << " {" << p.init << "};\n";
+
+        if (!(p.f & (LOCK | RWLOCK | DISTRIBUTED_RWLOCK)))
+          write_schema_macro (p);
+      }
+
+    auto runs = field_runs (after);
+
+    if (sc.equality)
+      {
+        cout << '\n';
+        write_schema_equality (sc, runs);
+      }
+
+    if (sc.hash)
+      {
+        cout << '\n';
+        write_schema_hash (sc, runs);
+      }
+
+    cout << "\n";
+    cout << "private:\n";
+
+    std::vector<std::string> checked;
+
+    for (const auto &m : members)
+      {
+        if (std::find (checked.begin (), checked.end (), m.type)
+            != checked.end ())
+          continue;
+
+        checked.push_back (m.type);
+        cout << "  static_assert (sizeof (" << m.type << ") == " << m.size
+          << "\n";
+        cout << "                 && alignof (" << m.type << ") == "
+          << m.align << ",\n";
+        cout << "                 \"schema layout assumption for "
+          << m.type << " does not hold\");\n";
+      }
+
+    cout << "};\n";
+    cout << '\n';
+    cout << "static_assert (sizeof (" << sc.class_name << ") == "
+      << after.size << ",\n";
+    cout << "               \"generated layout of " << sc.class_name
+      << " does not hold\");\n";
+
+    if (!sc.namespace_name.empty ())
+      cout << "}\n";
+
+    cout << '\n';
+    cout << "#endif /* " << guard << " */\n";
+  }
 }
 
 int
-main ()
+main (int argc,
+      char **argv)
 {
+  if (argc == 3 && std::strcmp (argv[1], "--schema") == 0)
+    {
+      std::ifstream in {argv[2]};
+
+      if (!in)
+        {
+          std::cerr << argv[2] << ": cannot open the schema\n";
+          return 1;
+        }
+
+      try
+        {
+          write_schema_class (parse_schema (in), argv[2]);
+        }
+      catch (const schema_error &e)
+        {
+          std::cerr << argv[2] << ':' << e.line << ": " << e.message << '\n';
+          return 1;
+        }
+
+      return 0;
+    }
+  else if (argc == 2 && std::strcmp (argv[1], "--profile") == 0)
+    profile_accesses = true;
+  else if (argc != 1)
+    {
+      std::cerr << "usage: " << argv[0] << " [--profile | --schema FILE]\n";
+      return 1;
+    }
+
   cout << "// Generated definitions for <faster/core/property.hh>.\n";
   cout << "// Do not edit this file! Edit gen_property.cc instead.\n";
 
@@ -585,6 +1873,9 @@ main ()
 
 )123";
 
+  if (profile_accesses)
+    cout << "#include <faster/core/profile.hh>\n\n";
+
   for (features f = 0; f <= FEATURES_MAX; f ++)
     generate (f);
 
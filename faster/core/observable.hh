@@ -0,0 +1,230 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_OBSERVABLE_HH__
+#define __FASTER_CORE_OBSERVABLE_HH__
+
+/*
+ * Coalesced change notifications
+ *
+ * SUMMARY
+ *
+ * The *_OBS property variants notify observers about changes, but not from
+ * the setters.  A setter only records that the property changed, together
+ * with its value before the first change, in the notification_hub of the
+ * object.  flush_notifications then calls the observers of every changed
+ * property once, with that old value and the current one, no matter how many
+ * times the property was set in between.  It can be called explicitly (like
+ * once per event loop iteration) or periodically by a timer thread.
+ *
+ * Setters of properties without observers do not even take the lock of the
+ * hub.  Classes with such properties must contain FASTER_NOTIFICATION_HUB,
+ * which declares the hub and the flush_notifications method.
+ *
+ * IMPLEMENTATION
+ *
+ * Setters of observed properties record the change and assign the value
+ * under the lock of the hub.  flush_notifications takes the list of changed
+ * properties and copies their current values under that lock, then calls
+ * the observers without holding it, so observers may set properties (the
+ * changes are delivered by the next flush).  Flushes and adding observers
+ * are serialized by another lock, so observers must not add observers.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace faster::core
+{
+  /*
+   * Called with the old and the new value.
+   */
+  template <typename T>
+  using observer = std::function<void (const T &, const T &)>;
+
+  template <typename T>
+  class observers;
+
+  class notification_hub
+  {
+  public:
+    notification_hub () = default;
+
+    notification_hub (const notification_hub &) = delete;
+    notification_hub &operator= (const notification_hub &) = delete;
+
+    /*
+     * Notifies the observers of all properties changed since the last flush.
+     * Returns the number of notified properties.
+     */
+    std::size_t
+    flush ()
+    {
+      std::lock_guard dispatch {dispatch_};
+
+      {
+        std::lock_guard lock {mutex_};
+
+        // Both vectors keep their capacity, flushing does not allocate.
+        flushing_.swap (changed_);
+
+        for (node *n : flushing_)
+          n->snapshot ();
+      }
+
+      for (node *n : flushing_)
+        n->dispatch ();
+
+      std::size_t count = flushing_.size ();
+      flushing_.clear ();
+      return count;
+    }
+
+  private:
+    template <typename T>
+    friend class observers;
+
+    struct node
+    {
+      virtual void
+      snapshot () = 0;
+
+      virtual void
+      dispatch () = 0;
+
+    protected:
+      ~node () = default;
+    };
+
+    std::mutex mutex_;
+    std::mutex dispatch_;
+    std::vector<node *> changed_;
+    std::vector<node *> flushing_;
+  };
+
+  /*
+   * The observers of a single property of type T, and its pending change.
+   */
+  template <typename T>
+  class observers final : notification_hub::node
+  {
+  public:
+    observers () = default;
+
+    observers (const observers &) = delete;
+    observers &operator= (const observers &) = delete;
+
+    bool
+    observed ()
+      const noexcept
+    {
+      return observed_.load (std::memory_order_relaxed);
+    }
+
+    void
+    add (notification_hub &hub,
+         observer<T> function)
+    {
+      std::lock_guard dispatch {hub.dispatch_};
+
+      observers_.push_back (std::move (function));
+      observed_.store (true, std::memory_order_relaxed);
+    }
+
+    /*
+     * Assigns value to field (the property this object observes), recording
+     * the change if there are any observers.
+     */
+    template <typename U>
+    void
+    set (notification_hub &hub,
+         T &field,
+         U &&value)
+    {
+      if (!observed ())
+        {
+          field = std::forward<U> (value);
+          return;
+        }
+
+      std::lock_guard lock {hub.mutex_};
+
+      if (!old_)
+        {
+          old_.emplace (field);
+          field_ = &field;
+          hub.changed_.push_back (this);
+        }
+
+      field = std::forward<U> (value);
+    }
+
+  private:
+    void
+    snapshot ()
+      override
+    {
+      flushed_old_.emplace (std::move (*old_));
+      flushed_new_.emplace (*field_);
+      old_.reset ();
+    }
+
+    void
+    dispatch ()
+      override
+    {
+      for (auto &function : observers_)
+        function (*flushed_old_, *flushed_new_);
+
+      flushed_old_.reset ();
+      flushed_new_.reset ();
+    }
+
+    std::atomic<bool> observed_ {false};
+    std::vector<observer<T>> observers_;
+
+    // Guarded by the lock of the hub.
+    std::optional<T> old_;
+    const T *field_ = nullptr;
+
+    // Guarded by the dispatch lock of the hub.
+    std::optional<T> flushed_old_;
+    std::optional<T> flushed_new_;
+  };
+}
+
+/**
+ * Declares the notification hub used by *_OBS properties, and the
+ * flush_notifications method, which notifies their observers.
+ */
+#define FASTER_NOTIFICATION_HUB \
+  private: \
+  faster::core::notification_hub faster_notifications_; \
+  \
+  public: \
+  std::size_t \
+  flush_notifications () \
+  { \
+    return faster_notifications_.flush (); \
+  }
+
+#endif /* __FASTER_CORE_OBSERVABLE_HH__ */
@@ -0,0 +1,590 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_PROFILE_HH__
+#define __FASTER_CORE_PROFILE_HH__
+
+/*
+ * Property access profiling
+ *
+ * SUMMARY
+ *
+ * When Faster is configured with -Dprofile_properties=true, property.tcc is
+ * generated using "gen_property --profile".  The accessors are then not
+ * constexpr, and every one of them owns a static profile_site, which counts
+ * its calls.  Const getters count as reads, setters and *_emplace as writes.
+ * *_DEFER setters count in the calling thread, even if the assignment is
+ * deferred to the owner.
+ *
+ * Nonconst getters are what plain reads of nonconst objects call, but their
+ * result may as well be modified, so they count as mutable accesses, which
+ * are reported separately and left out of the read ratio.  Setters assign
+ * the field directly, so they are not counted twice, except for virtual
+ * properties, whose setters go through the (maybe overridden) nonconst
+ * getter.
+ *
+ * The profile_registry sums the counts per property, named by its class
+ * (taken from __PRETTY_FUNCTION__) and name, and ranks the properties by the
+ * number of accesses.  It writes the report to standard error at exit, or
+ * to any stream when asked to using report.  Besides the number of reads,
+ * writes and mutable accesses, it tells how many threads accessed the
+ * property.
+ *
+ * IMPLEMENTATION
+ *
+ * Counting every access would make profiled programs much slower, so only
+ * about one in FASTER_PROFILE_PERIOD accesses (16 by default) of a thread is
+ * recorded, weighted by the period.  The gaps between samples are random, so
+ * access patterns which repeat with the period do not skew the counts.  The
+ * counts are thus estimates, unless FASTER_PROFILE_PERIOD is defined to 1.
+ *
+ * Samples are recorded in a table of the recording thread, without any read-
+ * modify-write operations.  The registry reads the tables of live threads
+ * when reporting, and adds the tables of finished threads to its totals.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef FASTER_PROFILE_PERIOD
+# define FASTER_PROFILE_PERIOD 16
+#endif
+
+namespace faster::core
+{
+  namespace detail
+  {
+    constexpr std::uint32_t PROFILE_PERIOD = FASTER_PROFILE_PERIOD;
+
+    static_assert (PROFILE_PERIOD > 0, "FASTER_PROFILE_PERIOD must be > 0");
+
+    // Whether identifier occurs in text as a whole token.
+    inline bool
+    mentions (const std::string &text,
+              const std::string &identifier)
+    {
+      auto is_word = [] (char c) {
+        return c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')
+          || (c >= 'A' && c <= 'Z');
+      };
+
+      for (std::size_t at = text.find (identifier); at != std::string::npos;
+           at = text.find (identifier, at + 1))
+        if ((at == 0 || !is_word (text[at - 1]))
+            && (at + identifier.size () == text.size ()
+                || !is_word (text[at + identifier.size ()])))
+          return true;
+
+      return false;
+    }
+
+    /*
+     * Names the property of an accessor, like "ns::cls::name" for
+     * "const int& ns::cls::name() const" and "name".  The class is taken
+     * from the qualified function name in __PRETTY_FUNCTION__.  Arguments of
+     * class templates described after the signature are kept, so their
+     * instances are told apart, but arguments of member templates (like
+     * those of *_emplace) are not.
+     */
+    inline std::string
+    property_name (const std::string &function,
+                   const std::string &name)
+    {
+      std::string result = function;
+      std::string arguments;
+
+      // Like " [with T = int]" (GCC) or " [T = int]" (Clang).
+      if (!result.empty () && result.back () == ']')
+        {
+          std::size_t bracket = result.size () - 1;
+          int nesting = 0;
+
+          do
+            {
+              if (result[bracket] == ']')
+                nesting ++;
+              else if (result[bracket] == '[')
+                nesting --;
+            }
+          while (nesting > 0 && bracket -- > 0);
+
+          if (nesting == 0 && bracket > 0 && result[bracket - 1] == ' ')
+            {
+              arguments = result.substr (bracket + 1,
+                                         result.size () - bracket - 2);
+              result.erase (bracket - 1);
+
+              if (arguments.compare (0, 5, "with ") == 0)
+                arguments.erase (0, 5);
+            }
+        }
+
+      std::size_t close = result.rfind (')');
+
+      if (close == std::string::npos)
+        return name;
+
+      // Find the parenthesis opening the parameter list.
+      std::size_t open = close;
+      int depth = 0;
+
+      do
+        {
+          if (result[open] == ')')
+            depth ++;
+          else if (result[open] == '(')
+            depth --;
+        }
+      while (depth > 0 && open -- > 0);
+
+      // And the start of the name, skipping spaces in template arguments.
+      std::size_t start = open;
+      std::size_t scope = std::string::npos;
+      depth = 0;
+
+      while (start > 0)
+        {
+          char c = result[start - 1];
+
+          if (c == '>')
+            depth ++;
+          else if (c == '<')
+            depth --;
+          else if (depth == 0 && (c == ' ' || c == '*' || c == '&'))
+            break;
+          else if (depth == 0 && c == ':' && scope == std::string::npos)
+            scope = start - 1;
+
+          start --;
+        }
+
+      std::string cls;
+
+      if (scope != std::string::npos && scope > start)
+        cls = result.substr (start, scope - 1 - start);
+
+      // Like "U = char; T = long int" (or with commas), keep those the class
+      // refers to.
+      std::string kept;
+      std::string separator;
+      std::size_t item = 0;
+      depth = 0;
+
+      for (std::size_t i = 0; i <= arguments.size (); i ++)
+        {
+          char c = i < arguments.size () ? arguments[i] : ';';
+
+          if (c == '(' || c == '<' || c == '[' || c == '{')
+            depth ++;
+          else if (c == ')' || c == '>' || c == ']' || c == '}')
+            depth --;
+          else if ((c == ';' || c == ',') && depth == 0)
+            {
+              std::string argument = arguments.substr (item, i - item);
+              std::string parameter
+                = argument.substr (0, argument.find (" = "));
+
+              if (mentions (cls, parameter))
+                kept += (kept.empty () ? "" : separator) + argument;
+
+              if (i < arguments.size ())
+                separator = {c, ' '};
+
+              item = i + 2;
+            }
+        }
+
+      return (cls.empty () ? name : cls + "::" + name)
+        + (kept.empty () ? "" : " [with " + kept + "]");
+    }
+
+    struct profile_counter
+    {
+      std::atomic<std::uint64_t> reads {0};
+      std::atomic<std::uint64_t> writes {0};
+      std::atomic<std::uint64_t> mutables {0};
+    };
+
+    enum class profile_access
+    {
+      READ,
+      WRITE,
+      MUTABLE
+    };
+
+    class profile_table;
+  }
+
+  struct profile_entry
+  {
+    std::string property;
+    std::uint64_t reads = 0;
+    std::uint64_t writes = 0;
+    // Calls of nonconst getters, which may be reads or writes.
+    std::uint64_t mutables = 0;
+    std::size_t threads = 0;
+  };
+
+  class profile_registry
+  {
+  public:
+    static profile_registry &
+    instance ()
+    {
+      static profile_registry registry;
+      return registry;
+    }
+
+    profile_registry (const profile_registry &) = delete;
+    profile_registry &operator= (const profile_registry &) = delete;
+
+    /*
+     * Writes the report at exit, if anything was recorded.
+     */
+    ~profile_registry ()
+    {
+      std::vector<profile_entry> entries = snapshot ();
+
+      if (!entries.empty ())
+        report (std::cerr, entries);
+    }
+
+    /*
+     * The accessed properties, with their accesses summed over all
+     * accessors, the most accessed first.
+     */
+    std::vector<profile_entry>
+    snapshot ()
+      const;
+
+    void
+    report (std::ostream &out)
+      const
+    {
+      report (out, snapshot ());
+    }
+
+  private:
+    friend class profile_site;
+    friend class detail::profile_table;
+
+    profile_registry () = default;
+
+    std::size_t
+    add_site (const char *function,
+              const char *name)
+    {
+      std::string property = detail::property_name (function, name);
+      std::lock_guard lock {mutex_};
+
+      // Getters and setters of a property are separate sites.
+      auto it = std::find_if (retired_.begin (), retired_.end (),
+                              [&property] (const profile_entry &entry) {
+                                return entry.property == property;
+                              });
+
+      if (it == retired_.end ())
+        {
+          retired_.emplace_back ();
+          retired_.back ().property = std::move (property);
+          it = retired_.end () - 1;
+        }
+
+      site_property_.push_back (it - retired_.begin ());
+      return site_property_.size () - 1;
+    }
+
+    // Adds the counts of a table to entries, which are indexed like
+    // retired_.  Expects the lock to be held.
+    void
+    add_table (const detail::profile_table &table,
+               std::vector<profile_entry> &entries)
+      const;
+
+    static void
+    report (std::ostream &out,
+            const std::vector<profile_entry> &entries)
+    {
+      std::size_t width = 8;
+
+      for (const auto &entry : entries)
+        width = std::max (width, entry.property.size ());
+
+      out << "faster: property accesses, sampled every "
+        << detail::PROFILE_PERIOD << " on average\n";
+      out << std::left << std::setw (width) << "property" << std::right
+        << std::setw (16) << "reads" << std::setw (16) << "writes"
+        << std::setw (16) << "mutable" << std::setw (8) << "read%"
+        << std::setw (9) << "threads\n";
+
+      for (const auto &entry : entries)
+        {
+          // Mutable accesses are neither.
+          std::uint64_t total = entry.reads + entry.writes;
+
+          out << std::left << std::setw (width) << entry.property
+            << std::right << std::setw (16) << entry.reads
+            << std::setw (16) << entry.writes << std::setw (16)
+            << entry.mutables << std::setw (8)
+            << (total ? entry.reads * 100 / total : 0)
+            << std::setw (8) << entry.threads << '\n';
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<std::size_t> site_property_;
+    // Per property, the totals of finished threads.
+    std::vector<profile_entry> retired_;
+    std::vector<detail::profile_table *> tables_;
+  };
+
+  namespace detail
+  {
+    /*
+     * The counters of a single thread, one per site.  Only the owning thread
+     * writes them.  Chunks are published atomically, so the registry can
+     * read them any time.
+     */
+    class profile_table
+    {
+    public:
+      static constexpr std::size_t CHUNK_SIZE = 256;
+      static constexpr std::size_t MAX_CHUNKS = 256;
+
+      profile_table ()
+      {
+        profile_registry &registry = profile_registry::instance ();
+        std::lock_guard lock {registry.mutex_};
+
+        registry.tables_.push_back (this);
+      }
+
+      profile_table (const profile_table &) = delete;
+      profile_table &operator= (const profile_table &) = delete;
+
+      ~profile_table ()
+      {
+        profile_registry &registry = profile_registry::instance ();
+        std::lock_guard lock {registry.mutex_};
+
+        registry.add_table (*this, registry.retired_);
+
+        auto &tables = registry.tables_;
+        tables.erase (std::find (tables.begin (), tables.end (), this));
+
+        for (auto &chunk : chunks_)
+          delete[] chunk.load (std::memory_order_relaxed);
+      }
+
+      static profile_table &
+      current ()
+      {
+        thread_local profile_table table;
+        return table;
+      }
+
+      const profile_counter *
+      find (std::size_t site)
+        const noexcept
+      {
+        if (site / CHUNK_SIZE >= MAX_CHUNKS)
+          return nullptr;
+
+        const profile_counter *chunk
+          = chunks_[site / CHUNK_SIZE].load (std::memory_order_acquire);
+
+        return chunk ? &chunk[site % CHUNK_SIZE] : nullptr;
+      }
+
+      void
+      add (std::size_t site,
+           profile_access access,
+           std::uint64_t count)
+      {
+        if (site / CHUNK_SIZE >= MAX_CHUNKS)
+          return;
+
+        auto &slot = chunks_[site / CHUNK_SIZE];
+        profile_counter *chunk = slot.load (std::memory_order_relaxed);
+
+        if (!chunk)
+          {
+            chunk = new profile_counter[CHUNK_SIZE];
+            slot.store (chunk, std::memory_order_release);
+          }
+
+        profile_counter &counters = chunk[site % CHUNK_SIZE];
+        auto &counter = access == profile_access::READ ? counters.reads
+          : access == profile_access::WRITE ? counters.writes
+          : counters.mutables;
+
+        // Only this thread writes the counter.
+        counter.store (counter.load (std::memory_order_relaxed) + count,
+                       std::memory_order_relaxed);
+      }
+
+    private:
+      std::array<std::atomic<profile_counter *>, MAX_CHUNKS> chunks_ {};
+    };
+
+    struct profile_sampler
+    {
+      std::uint32_t countdown = 1;
+      std::uint32_t state = 0;
+
+      // The gap to the next sample, between 1 and 2 * PROFILE_PERIOD - 1.
+      std::uint32_t
+      next_gap ()
+        noexcept
+      {
+        if (!state)
+          state = static_cast<std::uint32_t>
+            (reinterpret_cast<std::uintptr_t> (this)) | 1;
+
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        return 1 + state % (2 * PROFILE_PERIOD - 1);
+      }
+    };
+
+    inline thread_local profile_sampler sampler;
+  }
+
+  /*
+   * A profiled accessor of the property name, function is its
+   * __PRETTY_FUNCTION__.  Sites are never destroyed before the registry
+   * (they are static locals constructed after it).
+   */
+  class profile_site
+  {
+  public:
+    profile_site (const char *function,
+                  const char *name)
+      : index_ {profile_registry::instance ().add_site (function, name)}
+    {
+    }
+
+    profile_site (const profile_site &) = delete;
+    profile_site &operator= (const profile_site &) = delete;
+
+    void
+    read ()
+      noexcept
+    {
+      record (detail::profile_access::READ);
+    }
+
+    void
+    write ()
+      noexcept
+    {
+      record (detail::profile_access::WRITE);
+    }
+
+    void
+    mutable_access ()
+      noexcept
+    {
+      record (detail::profile_access::MUTABLE);
+    }
+
+  private:
+    void
+    record (detail::profile_access access)
+      noexcept
+    {
+      detail::profile_sampler &sampler = detail::sampler;
+
+      if (-- sampler.countdown)
+        return;
+
+      sampler.countdown = sampler.next_gap ();
+      detail::profile_table::current ().add (index_, access,
+                                             detail::PROFILE_PERIOD);
+    }
+
+    std::size_t index_;
+  };
+
+  inline void
+  profile_registry::add_table (const detail::profile_table &table,
+                               std::vector<profile_entry> &entries)
+    const
+  {
+    std::vector<bool> touched (entries.size ());
+
+    for (std::size_t i = 0; i < site_property_.size (); i ++)
+      if (const detail::profile_counter *c = table.find (i))
+        {
+          profile_entry &entry = entries[site_property_[i]];
+          std::uint64_t reads = c->reads.load (std::memory_order_relaxed);
+          std::uint64_t writes = c->writes.load (std::memory_order_relaxed);
+          std::uint64_t mutables
+            = c->mutables.load (std::memory_order_relaxed);
+
+          entry.reads += reads;
+          entry.writes += writes;
+          entry.mutables += mutables;
+
+          if (reads || writes || mutables)
+            touched[site_property_[i]] = true;
+        }
+
+    for (std::size_t i = 0; i < entries.size (); i ++)
+      if (touched[i])
+        entries[i].threads ++;
+  }
+
+  inline std::vector<profile_entry>
+  profile_registry::snapshot ()
+    const
+  {
+    std::lock_guard lock {mutex_};
+    std::vector<profile_entry> entries = retired_;
+
+    for (const detail::profile_table *table : tables_)
+      add_table (*table, entries);
+
+    entries.erase (std::remove_if (entries.begin (), entries.end (),
+                                   [] (const profile_entry &entry) {
+                                     return !entry.reads && !entry.writes
+                                       && !entry.mutables;
+                                   }),
+                   entries.end ());
+
+    std::stable_sort (entries.begin (), entries.end (),
+                      [] (const profile_entry &a, const profile_entry &b) {
+                        return a.reads + a.writes + a.mutables
+                          > b.reads + b.writes + b.mutables;
+                      });
+
+    return entries;
+  }
+}
+
+#endif /* __FASTER_CORE_PROFILE_HH__ */
@@ -87,6 +87,27 @@
  * *_CF                  - does not declare a field, accepts the field name
  *                         (may refer to fields of members or even to global
  *                         variables, this is flexible)
+ * *_DBUF                - the field is double-buffered (see
+ *                         <faster/core/double_buffer.hh>) for handing values
+ *                         over from one producer thread to one consumer
+ *                         thread.  The nonconst getter and the setters access
+ *                         the back buffer, <<Name>>_publish makes it the
+ *                         front buffer and the const getter returns the
+ *                         front buffer, so the consumer must read through a
+ *                         const reference.  Neither side waits and nothing
+ *                         is copied.  After publishing, the back buffer
+ *                         holds an older value, not the published one.  The
+ *                         accessors are not constexpr.
+ * *_DEFER               - setters called by threads other than the owner of
+ *                         the object are deferred until the owner calls
+ *                         apply_pending (see <faster/core/deferred.hh>).  The
+ *                         class must contain FASTER_PENDING_QUEUE.  Getters
+ *                         and owner's setters are plain, so other threads
+ *                         should not read the property.
+ * *_DRWLOCK             - Like *_RWLOCK, but the lock is a
+ *                         faster::core::distributed_shared_mutex, whose
+ *                         readers scale with the number of cores at the cost
+ *                         of much slower writers.
  * *_DT                  - (only for _CF or _NF) detects type using declype()
  * *_EX                  - allow the functions to throw
  * *_LOCK                - A mutex is generated for the property.
@@ -97,23 +118,93 @@
  * *_NCP                 - not copiable (no copy setter)
  * *_NF                  - does not declare a field
  * *_NS                  - does not declare any setters
+ * *_OBS                 - (not with _NCP) the property can be observed.
+ *                         <<Name>>_observe (observer) adds an observer,
+ *                         called with the old and the new value.  Setters
+ *                         only record the change, flush_notifications
+ *                         delivers at most one notification per changed
+ *                         property (see <faster/core/observable.hh>).  The
+ *                         class must contain FASTER_NOTIFICATION_HUB.  There
+ *                         is no nonconst getter, as changes made through it
+ *                         could not be observed.
  * *_OV                  - mark the functions as override
  * *_PBV                 - declares a PBV property
+ * *_PMR                 - (not with _PBV) the property type is allocator
+ *                         aware, like std::pmr::string.  The field is built
+ *                         on the memory resource of the object, declared by
+ *                         FASTER_MEMORY_RESOURCE (see <faster/core/arena.hh>)
+ *                         before the property, so constructors should not
+ *                         initialize it.  Setters copy into the field, which
+ *                         keeps its allocator, and <<Name>>_emplace (args...)
+ *                         builds a new value from args directly on it (it is
+ *                         a member template, so local classes cannot use
+ *                         this variant).
  * *_PRIV                - declares a private property
  * *_PRIVSET             - declares a property with private nonconst functions
  * *_REF                 - declares a property whose value is a reference
  * *_RO                  - declares a read-only property, there is no nonconst
  *                         getter and there are no setters. The field, if
  *                         generated, is const.
+ * *_REPLICATED          - the field keeps one replica per NUMA node (see
+ *                         <faster/core/replicated.hh>).  Getters return a
+ *                         copy of the local replica, setters update all of
+ *                         them.  There is no nonconst getter and the
+ *                         accessors are not constexpr.
  * *_RWLOCK              - A shared mutex is generated for the property.
  * *_VOLATILE            - The field, if generated, is volatile.
  * *_VT                  - declares a virtual property
+ * *_WAIT                - (only for _PBV) the field is a waitable atomic
+ *                         value.  Besides the usual accessors, <<Name>>_wait
+ *                         (old) blocks until the value differs from old and
+ *                         <<Name>>_wait_for (pred, timeout) blocks until pred
+ *                         holds for the value or the timeout expires (it is
+ *                         a member template, so local classes cannot use
+ *                         this variant).  The setter only issues a wakeup if
+ *                         somebody is waiting.  There is no nonconst getter
+ *                         and the accessors are not constexpr.
  *
  * Please note that you have to include <mutex> or <shared_mutex> yourself.
+ * Likewise, *_DBUF properties need <faster/core/double_buffer.hh>, *_DEFER
+ * properties need <faster/core/deferred.hh>, *_DRWLOCK properties need
+ * <faster/core/shared_mutex.hh>, *_OBS properties need
+ * <faster/core/observable.hh>, *_PMR properties need
+ * <faster/core/arena.hh>, *_REPLICATED properties need
+ * <faster/core/replicated.hh> and *_WAIT properties need
+ * <faster/core/waitable.hh>.
  *
  * Not all feature combinations are supported. Use common sense and/or view
  * the generated definitions.
  *
+ * SCHEMAS
+ *
+ * Macros expand in declaration order, so the field layout is whatever the
+ * class author typed.  Running "gen_property --schema FILE" instead generates
+ * a whole class from a small schema file (see gen_property.cc for its
+ * syntax).  The fields are reordered to minimize padding, with fields marked
+ * hot placed first, and accessors are declared using the *_NF macros, so the
+ * API is the same.  The generated header starts with a report of the layout
+ * in declaration order and the generated one, and checks its layout
+ * assumptions using static_assert.  In Meson, use the core_gen_property
+ * executable in a custom_target.
+ *
+ * Schemas may also ask for operator==, operator!= and a hash method.  These
+ * compare and hash adjacent PBV fields of integral and pointer types as raw
+ * bytes (see <faster/core/bytes.hh>), skipping padding, and fall back to the
+ * field types' own == and std::hash for the rest.
+ *
+ * PROFILING
+ *
+ * Configuring Faster with -Dprofile_properties=true makes the accessors
+ * count their calls, so the read/write ratio and the number of threads
+ * accessing each property can be measured before choosing its variant.  The
+ * report is written to standard error at exit (see <faster/core/profile.hh>).
+ * The accessors are then not constexpr.  Without the option, the generated
+ * code does not change at all.
+ *
+ * A translation unit may also define FASTER_PROPERTY_TCC to the name of
+ * another file generated by gen_property (like with --profile), which is
+ * then included instead of <faster/core/property.tcc>.
+ *
  * SOURCE CODE
  *
  * The source of this file is generated using a helper C++ program, which
@@ -122,6 +213,10 @@
  */
 
 // Load the generated macros
-#include <faster/core/property.tcc>
+#ifdef FASTER_PROPERTY_TCC
+# include FASTER_PROPERTY_TCC
+#else
+# include <faster/core/property.tcc>
+#endif
 
 #endif /* __FASTER_CORE_PROPERTY_HH__ */
@@ -0,0 +1,296 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_REPLICATED_HH__
+#define __FASTER_CORE_REPLICATED_HH__
+
+/*
+ * Replicated values
+ *
+ * SUMMARY
+ *
+ * A replicated value keeps one copy per NUMA node (see
+ * <faster/core/topology.hh>), each in the memory of its node.  Reads go to
+ * the replica of the node the calling thread runs on, writes update all
+ * replicas under a writer lock.  It backs the *_REPLICATED property variants
+ * and is meant for read-mostly values, like configuration, read from all
+ * sockets.
+ *
+ * If std::atomic<T> is lock-free, every replica is such an atomic, stored
+ * with release and loaded with acquire semantics.  Readers then never write
+ * to shared memory, so each socket keeps its replica cached.  Otherwise every
+ * replica has its own shared mutex, so a reader only writes to a cache line
+ * of its own node.
+ *
+ * On single-node machines there is just one replica.
+ *
+ * IMPLEMENTATION
+ *
+ * On Linux, every replica gets its own freshly mapped pages, and is
+ * constructed while the constructing thread is pinned to the CPUs of its
+ * node (see node_affinity), so the default first-touch policy allocates the
+ * pages on that node.  Replicas the thread may not be pinned for (like when
+ * the node is outside its cpuset) stay wherever the kernel put them.  A
+ * replica thus takes at least a page, which is fine for the few values worth
+ * replicating.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+
+#ifdef __linux__
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include <faster/core/topology.hh>
+
+namespace faster::core
+{
+  namespace detail
+  {
+    // std::atomic<T> may not even be instantiated for other types.
+    template <typename T, bool = std::is_trivially_copyable_v<T>>
+    struct lock_free_atomic : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct lock_free_atomic<T, true>
+      : std::bool_constant<std::atomic<T>::is_always_lock_free>
+    {
+    };
+  }
+
+  template <typename T>
+  class replicated
+  {
+  public:
+    explicit
+    replicated (const T &value = T {},
+                const numa_topology &topology = numa_topology::system ())
+      : memory_ {nullptr}, stride_ {0}, mapped_ {false},
+        count_ {topology.nodes ()}, topology_ {&topology}, writer_ {}
+    {
+      allocate ();
+
+      std::size_t built = 0;
+
+      try
+        {
+          while (built < count_)
+            {
+              // The first touch of the replica is from its node.
+              node_affinity affinity {topology, built};
+              replica *r = new (memory_ + built * stride_) replica {};
+
+              built ++;
+              r->set (value);
+            }
+        }
+      catch (...)
+        {
+          destroy (built);
+          throw;
+        }
+    }
+
+    /*
+     * The topology is referenced, not copied, so it must outlive the value.
+     * Temporaries would not.
+     */
+    replicated (const T &value,
+                numa_topology &&topology) = delete;
+
+    replicated (const replicated &) = delete;
+    replicated &operator= (const replicated &) = delete;
+
+    ~replicated ()
+    {
+      destroy (count_);
+    }
+
+    std::size_t
+    replicas ()
+      const noexcept
+    {
+      return count_;
+    }
+
+    /*
+     * Reads the replica of the current node.
+     */
+    T
+    load ()
+      const
+    {
+      return load (topology_->current_node ());
+    }
+
+    /*
+     * Reads the replica of the given node.
+     */
+    T
+    load (std::size_t node)
+      const
+    {
+      return at (node < count_ ? node : 0).get ();
+    }
+
+    void
+    store (const T &value)
+    {
+      std::lock_guard lock {writer_};
+
+      for (std::size_t i = 0; i < count_; i ++)
+        at (i).set (value);
+    }
+
+    void
+    store (T &&value)
+    {
+      std::lock_guard lock {writer_};
+
+      // The last replica can take the value itself.
+      for (std::size_t i = 0; i + 1 < count_; i ++)
+        at (i).set (value);
+
+      at (count_ - 1).set (std::move (value));
+    }
+
+  private:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    struct atomic_replica
+    {
+      std::atomic<T> value;
+
+      T
+      get ()
+        const noexcept
+      {
+        return value.load (std::memory_order_acquire);
+      }
+
+      void
+      set (const T &new_value)
+        noexcept
+      {
+        value.store (new_value, std::memory_order_release);
+      }
+    };
+
+    struct locked_replica
+    {
+      mutable std::shared_mutex lock;
+      T value;
+
+      T
+      get ()
+        const
+      {
+        std::shared_lock guard {lock};
+        return value;
+      }
+
+      template <typename U>
+      void
+      set (U &&new_value)
+      {
+        std::unique_lock guard {lock};
+        value = std::forward<U> (new_value);
+      }
+    };
+
+    struct alignas (CACHE_LINE_SIZE) replica
+      : std::conditional_t<detail::lock_free_atomic<T>::value,
+                           atomic_replica, locked_replica>
+    {
+    };
+
+    replica &
+    at (std::size_t i)
+      const noexcept
+    {
+      return *std::launder (reinterpret_cast<replica *> (memory_
+                                                         + i * stride_));
+    }
+
+    void
+    allocate ()
+    {
+#ifdef __linux__
+      long page = sysconf (_SC_PAGESIZE);
+
+      // Untouched pages, placed by the first touch.
+      if (count_ > 1 && page > 0)
+        {
+          stride_ = (sizeof (replica) + page - 1) / page * page;
+
+          void *memory = mmap (nullptr, count_ * stride_,
+                               PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+          if (memory == MAP_FAILED)
+            throw std::bad_alloc {};
+
+          memory_ = static_cast<char *> (memory);
+          mapped_ = true;
+          return;
+        }
+#endif
+
+      stride_ = sizeof (replica);
+      memory_ = static_cast<char *>
+        (::operator new (count_ * stride_,
+                         std::align_val_t {alignof (replica)}));
+    }
+
+    // Destroys the first count replicas and frees the memory.
+    void
+    destroy (std::size_t count)
+      noexcept
+    {
+      for (std::size_t i = 0; i < count; i ++)
+        at (i).~replica ();
+
+#ifdef __linux__
+      if (mapped_)
+        {
+          munmap (memory_, count_ * stride_);
+          return;
+        }
+#endif
+
+      ::operator delete (memory_, std::align_val_t {alignof (replica)});
+    }
+
+    char *memory_;
+    std::size_t stride_;
+    bool mapped_;
+    std::size_t count_;
+    const numa_topology *topology_;
+    std::mutex writer_;
+  };
+}
+
+#endif /* __FASTER_CORE_REPLICATED_HH__ */
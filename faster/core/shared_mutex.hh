@@ -0,0 +1,197 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_SHARED_MUTEX_HH__
+#define __FASTER_CORE_SHARED_MUTEX_HH__
+
+/*
+ * Distributed shared mutex
+ *
+ * SUMMARY
+ *
+ * std::shared_mutex keeps its reader count in a single word, so every
+ * lock_shared and unlock_shared is an atomic read-modify-write on a cache line
+ * shared by all readers.  With many cores that line is what limits read
+ * throughput.
+ *
+ * distributed_shared_mutex (a "big-reader" lock) spreads the reader count
+ * over one cache line per slot, roughly one slot per CPU.  Each thread is
+ * assigned a slot when it first takes any such lock, so readers on different
+ * slots do not write to the same cache line.  A writer raises a flag and then
+ * waits for all slots to drain, which makes writing much more expensive than
+ * with std::shared_mutex.  Use it for read-mostly data only.
+ *
+ * It meets the SharedMutex requirements, so std::shared_lock, std::unique_lock
+ * and friends work with it.  It backs the *_DRWLOCK property variants.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace faster::core
+{
+  namespace detail
+  {
+    inline std::atomic<std::size_t> next_reader_slot {0};
+
+    inline std::size_t
+    reader_slot ()
+      noexcept
+    {
+      thread_local std::size_t slot = next_reader_slot.fetch_add (1);
+      return slot;
+    }
+  }
+
+  class distributed_shared_mutex
+  {
+  public:
+    distributed_shared_mutex ()
+      : slots_ {new slot[slot_count ()]}, mask_ {slot_count () - 1},
+        writers_ {}, writer_ {false}
+    {
+    }
+
+    distributed_shared_mutex (const distributed_shared_mutex &) = delete;
+    distributed_shared_mutex &
+    operator= (const distributed_shared_mutex &) = delete;
+
+    void
+    lock ()
+    {
+      writers_.lock ();
+      writer_.store (true);
+      wait_for_readers ();
+    }
+
+    bool
+    try_lock ()
+    {
+      if (!writers_.try_lock ())
+        return false;
+
+      writer_.store (true);
+
+      for (std::size_t i = 0; i <= mask_; i ++)
+        if (slots_[i].readers.load () != 0)
+          {
+            writer_.store (false);
+            writers_.unlock ();
+            return false;
+          }
+
+      return true;
+    }
+
+    void
+    unlock ()
+    {
+      writer_.store (false, std::memory_order_release);
+      writers_.unlock ();
+    }
+
+    void
+    lock_shared ()
+    {
+      auto &readers = slots_[detail::reader_slot () & mask_].readers;
+
+      for (;;)
+        {
+          // Pairs with lock: either the writer sees our count, or we see
+          // its flag.
+          readers.fetch_add (1);
+
+          if (!writer_.load ())
+            return;
+
+          readers.fetch_sub (1, std::memory_order_release);
+
+          while (writer_.load (std::memory_order_relaxed))
+            std::this_thread::yield ();
+        }
+    }
+
+    bool
+    try_lock_shared ()
+    {
+      auto &readers = slots_[detail::reader_slot () & mask_].readers;
+
+      readers.fetch_add (1);
+
+      if (!writer_.load ())
+        return true;
+
+      readers.fetch_sub (1, std::memory_order_release);
+      return false;
+    }
+
+    void
+    unlock_shared ()
+    {
+      slots_[detail::reader_slot () & mask_].readers
+        .fetch_sub (1, std::memory_order_release);
+    }
+
+  private:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+    static constexpr std::size_t MAX_SLOTS = 256;
+
+    struct alignas (CACHE_LINE_SIZE) slot
+    {
+      std::atomic<std::uint32_t> readers {0};
+    };
+
+    // The number of CPUs, rounded up to a power of two.
+    static std::size_t
+    slot_count ()
+      noexcept
+    {
+      static const std::size_t count = [] ()
+        {
+          std::size_t cpus = std::thread::hardware_concurrency ();
+          std::size_t result = 1;
+
+          while (result < cpus && result < MAX_SLOTS)
+            result *= 2;
+
+          return result;
+        } ();
+
+      return count;
+    }
+
+    void
+    wait_for_readers ()
+      const noexcept
+    {
+      for (std::size_t i = 0; i <= mask_; i ++)
+        while (slots_[i].readers.load () != 0)
+          std::this_thread::yield ();
+    }
+
+    std::unique_ptr<slot[]> slots_;
+    std::size_t mask_;
+    std::mutex writers_;
+    std::atomic<bool> writer_;
+  };
+}
+
+#endif /* __FASTER_CORE_SHARED_MUTEX_HH__ */
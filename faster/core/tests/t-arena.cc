@@ -0,0 +1,162 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <faster/core/arena.hh>
+
+using faster::core::arena;
+
+namespace
+{
+  // Counts the allocations passed to the default resource, and refuses too
+  // large ones.
+  class counting_resource : public std::pmr::memory_resource
+  {
+  public:
+    std::size_t allocations = 0;
+    std::size_t live = 0;
+    std::size_t limit = std::size_t {1} << 30;
+
+  protected:
+    void *
+    do_allocate (std::size_t bytes,
+                 std::size_t alignment)
+      override
+    {
+      if (bytes > limit)
+        throw std::bad_alloc {};
+
+      allocations ++;
+      live ++;
+      return std::pmr::new_delete_resource ()->allocate (bytes, alignment);
+    }
+
+    void
+    do_deallocate (void *p,
+                   std::size_t bytes,
+                   std::size_t alignment)
+      override
+    {
+      live --;
+      std::pmr::new_delete_resource ()->deallocate (p, bytes, alignment);
+    }
+
+    bool
+    do_is_equal (const std::pmr::memory_resource &other)
+      const noexcept override
+    {
+      return this == &other;
+    }
+  };
+}
+
+TEST (arena, alignment)
+{
+  arena a {256};
+
+  for (std::size_t alignment = 1; alignment <= 256; alignment *= 2)
+    for (std::size_t bytes : {1, 3, 16, 100, 1000})
+      {
+        void *p = a.allocate (bytes, alignment);
+
+        ASSERT_NE (p, nullptr);
+        ASSERT_EQ (reinterpret_cast<std::uintptr_t> (p) % alignment, 0u);
+      }
+}
+
+TEST (arena, distinct)
+{
+  arena a {256};
+  std::vector<char *> blocks;
+
+  for (int i = 0; i < 100; i ++)
+    {
+      auto p = static_cast<char *> (a.allocate (24, 8));
+      std::fill (p, p + 24, static_cast<char> (i));
+      blocks.push_back (p);
+    }
+
+  for (int i = 0; i < 100; i ++)
+    for (int j = 0; j < 24; j ++)
+      ASSERT_EQ (blocks[i][j], static_cast<char> (i));
+}
+
+TEST (arena, reset_keeps_chunk)
+{
+  counting_resource upstream;
+
+  {
+    arena a {256, &upstream};
+
+    for (int round = 0; round < 10; round ++)
+      {
+        std::pmr::vector<std::pmr::string> strings {&a};
+
+        for (int i = 0; i < 100; i ++)
+          strings.emplace_back (40, 'x');
+
+        a.reset ();
+
+        // Everything fits into the largest chunk from the first round.
+        if (round == 0)
+          {
+            ASSERT_EQ (upstream.live, 1u);
+          }
+      }
+
+    std::size_t allocations = upstream.allocations;
+
+    std::pmr::vector<std::pmr::string> strings {&a};
+
+    for (int i = 0; i < 100; i ++)
+      strings.emplace_back (40, 'x');
+
+    ASSERT_EQ (upstream.allocations, allocations);
+  }
+
+  ASSERT_EQ (upstream.live, 0u);
+}
+
+TEST (arena, overflow)
+{
+  constexpr std::size_t MAX_SIZE = std::numeric_limits<std::size_t>::max ();
+
+  counting_resource upstream;
+  arena a {256, &upstream};
+
+  // Doubling the chunk size would overflow, then adding the chunk header
+  // would.
+  for (std::size_t bytes : {MAX_SIZE / 2 + 1, MAX_SIZE - 8, MAX_SIZE})
+    {
+      void *p = nullptr;
+      ASSERT_THROW (p = a.allocate (bytes, 8), std::bad_alloc);
+      ASSERT_EQ (p, nullptr);
+    }
+
+  // The arena still works.
+  ASSERT_NE (a.allocate (16, 8), nullptr);
+  ASSERT_EQ (upstream.live, 1u);
+}
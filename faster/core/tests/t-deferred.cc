@@ -0,0 +1,81 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <faster/core/deferred.hh>
+
+using faster::core::pending_queue;
+
+TEST (pending_queue, order)
+{
+  pending_queue queue;
+  std::vector<int> applied;
+
+  ASSERT_TRUE (queue.owned ());
+
+  for (int i = 0; i < 3; i ++)
+    queue.push ([&applied, i] () { applied.push_back (i); });
+
+  ASSERT_TRUE (applied.empty ());
+  ASSERT_EQ (queue.apply (), 3u);
+  ASSERT_EQ (applied, (std::vector<int> {0, 1, 2}));
+}
+
+TEST (pending_queue, producers)
+{
+  pending_queue queue;
+  std::vector<int> last (4, -1);
+  std::vector<std::thread> producers;
+  std::size_t applied = 0;
+
+  for (int t = 0; t < 4; t ++)
+    producers.emplace_back ([&queue, &last, t] () {
+      ASSERT_FALSE (queue.owned ());
+
+      for (int i = 0; i < 10000; i ++)
+        queue.push ([&last, t, i] () {
+          // Updates of one producer arrive in order.
+          ASSERT_EQ (last[t], i - 1);
+          last[t] = i;
+        });
+    });
+
+  // Drain concurrently, like an event loop would.
+  while (applied < 40000)
+    applied += queue.apply ();
+
+  for (auto &producer : producers)
+    producer.join ();
+
+  ASSERT_EQ (queue.apply (), 0u);
+  ASSERT_EQ (last, (std::vector<int> (4, 9999)));
+}
+
+TEST (pending_queue, dropped)
+{
+  bool applied = false;
+
+  {
+    pending_queue queue;
+    queue.push ([&applied] () { applied = true; });
+  }
+
+  ASSERT_FALSE (applied);
+}
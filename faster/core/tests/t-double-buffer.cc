@@ -0,0 +1,116 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <faster/core/double_buffer.hh>
+
+using faster::core::double_buffer;
+
+TEST (double_buffer, initial)
+{
+  double_buffer<int> buffer {7};
+
+  ASSERT_EQ (buffer.front (), 7);
+  ASSERT_EQ (buffer.back (), 7);
+}
+
+TEST (double_buffer, publish)
+{
+  double_buffer<int> buffer;
+
+  buffer.back () = 1;
+  ASSERT_EQ (buffer.front (), 0);
+
+  buffer.publish ();
+  ASSERT_EQ (buffer.front (), 1);
+
+  // Unpublished values are not visible, the last published one stays.
+  buffer.back () = 2;
+  ASSERT_EQ (buffer.front (), 1);
+
+  // Publishing twice before the consumer looks skips a value.
+  buffer.publish ();
+  buffer.back () = 3;
+  buffer.publish ();
+  ASSERT_EQ (buffer.front (), 3);
+  ASSERT_EQ (buffer.front (), 3);
+}
+
+TEST (double_buffer, stable_front)
+{
+  double_buffer<int> buffer;
+  buffer.back () = 1;
+  buffer.publish ();
+
+  const int &front = buffer.front ();
+
+  // The producer never touches the buffer the consumer holds.
+  for (int i = 2; i < 10; i ++)
+    {
+      buffer.back () = i;
+      buffer.publish ();
+      ASSERT_EQ (front, 1);
+    }
+
+  ASSERT_EQ (buffer.front (), 9);
+}
+
+TEST (double_buffer, threads)
+{
+  // Every frame is filled with its number, so a torn frame is detected.
+  using frame = std::array<long, 64>;
+
+  constexpr long FRAMES = 100000;
+
+  double_buffer<frame> buffer;
+  std::atomic<bool> done {false};
+
+  std::thread producer {[&buffer, &done] () {
+    for (long i = 1; i <= FRAMES; i ++)
+      {
+        buffer.back ().fill (i);
+        buffer.publish ();
+      }
+
+    done.store (true);
+  }};
+
+  long last = 0;
+
+  for (;;)
+    {
+      bool finished = done.load ();
+      const frame &f = buffer.front ();
+
+      for (long value : f)
+        ASSERT_EQ (value, f[0]);
+
+      // Frames never go back in time.
+      ASSERT_GE (f[0], last);
+      last = f[0];
+
+      if (finished)
+        break;
+    }
+
+  producer.join ();
+  ASSERT_EQ (last, FRAMES);
+}
@@ -0,0 +1,121 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <faster/core/observable.hh>
+
+using faster::core::notification_hub;
+using faster::core::observers;
+
+TEST (observable, unobserved)
+{
+  notification_hub hub;
+  observers<int> obs;
+  int field = 1;
+
+  ASSERT_FALSE (obs.observed ());
+  obs.set (hub, field, 2);
+  ASSERT_EQ (field, 2);
+  ASSERT_EQ (hub.flush (), 0u);
+}
+
+TEST (observable, coalesced)
+{
+  notification_hub hub;
+  observers<int> a_obs, b_obs;
+  int a = 1, b = 10;
+  std::vector<std::pair<int, int>> a_changes, b_changes;
+
+  a_obs.add (hub, [&a_changes] (int old_value, int new_value) {
+    a_changes.emplace_back (old_value, new_value);
+  });
+  b_obs.add (hub, [&b_changes] (int old_value, int new_value) {
+    b_changes.emplace_back (old_value, new_value);
+  });
+
+  for (int i = 2; i <= 100; i ++)
+    a_obs.set (hub, a, i);
+  b_obs.set (hub, b, 11);
+
+  ASSERT_EQ (hub.flush (), 2u);
+  ASSERT_EQ (a_changes, (std::vector<std::pair<int, int>> {{1, 100}}));
+  ASSERT_EQ (b_changes, (std::vector<std::pair<int, int>> {{10, 11}}));
+
+  // The next flush starts from the last delivered value.
+  a_obs.set (hub, a, 101);
+  ASSERT_EQ (hub.flush (), 1u);
+  ASSERT_EQ (a_changes.back (), (std::pair<int, int> {100, 101}));
+  ASSERT_EQ (b_changes.size (), 1u);
+}
+
+TEST (observable, set_from_observer)
+{
+  notification_hub hub;
+  observers<int> obs;
+  int field = 0;
+  std::vector<int> seen;
+
+  obs.add (hub, [&] (int, int new_value) {
+    seen.push_back (new_value);
+
+    if (new_value < 3)
+      obs.set (hub, field, new_value + 1);
+  });
+
+  obs.set (hub, field, 1);
+
+  // Changes made by observers are delivered by the next flush.
+  while (hub.flush ())
+    ;
+
+  ASSERT_EQ (seen, (std::vector<int> {1, 2, 3}));
+}
+
+TEST (observable, timer_thread)
+{
+  notification_hub hub;
+  observers<long> obs;
+  long field = 0;
+  long last = 0;
+  std::atomic<bool> done {false};
+
+  obs.add (hub, [&last] (long old_value, long new_value) {
+    // Notifications chain up: nothing is lost, only coalesced.
+    ASSERT_EQ (old_value, last);
+    ASSERT_GT (new_value, old_value);
+    last = new_value;
+  });
+
+  std::thread timer {[&hub, &done] () {
+    while (!done.load ())
+      hub.flush ();
+
+    hub.flush ();
+  }};
+
+  for (long i = 1; i <= 100000; i ++)
+    obs.set (hub, field, i);
+
+  done.store (true);
+  timer.join ();
+  ASSERT_EQ (last, 100000);
+}
@@ -0,0 +1,202 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Count every access, so the counts are exact.
+#define FASTER_PROFILE_PERIOD 1
+
+// Built with FASTER_PROPERTY_TCC naming the output of
+// "gen_property --profile", see meson.build.
+#ifndef FASTER_PROPERTY_TCC
+# error FASTER_PROPERTY_TCC has to name a profiling property.tcc
+#endif
+
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <gtest/gtest.h>
+#include <faster/core/arena.hh>
+#include <faster/core/deferred.hh>
+#include <faster/core/profile.hh>
+#include <faster/core/property.hh>
+
+using faster::core::profile_entry;
+using faster::core::profile_registry;
+
+namespace profiled
+{
+  class config
+  {
+  public:
+    FASTER_PROPERTY_PBV (limit, int)
+    FASTER_PROPERTY (name, std::string)
+  };
+
+  class buffers
+  {
+  public:
+    FASTER_MEMORY_RESOURCE
+    FASTER_PROPERTY_PMR (str, std::pmr::string)
+  };
+
+  template <typename T>
+  class holder
+  {
+  public:
+    FASTER_PROPERTY (value, T)
+  };
+
+  class deferred
+  {
+  public:
+    FASTER_PENDING_QUEUE
+    FASTER_PROPERTY_PBV_DEFER (num, int)
+  };
+
+  profile_entry
+  find_entry (const std::string &property)
+  {
+    for (const auto &entry : profile_registry::instance ().snapshot ())
+      if (entry.property == property)
+        return entry;
+
+    return {};
+  }
+
+  std::size_t
+  count_entries (const std::string &prefix)
+  {
+    std::size_t count = 0;
+
+    for (const auto &entry : profile_registry::instance ().snapshot ())
+      if (entry.property.compare (0, prefix.size (), prefix) == 0)
+        count ++;
+
+    return count;
+  }
+}
+
+TEST (profile_property, getters)
+{
+  profiled::config x {};
+  const profiled::config &cx = x;
+  int sum = 0;
+
+  // Plain reads of a nonconst object are not writes.
+  for (int i = 0; i < 1000; i ++)
+    sum += x.limit () + static_cast<int> (x.name ().size ());
+
+  for (int i = 0; i < 10; i ++)
+    sum += cx.limit () + static_cast<int> (cx.name ().size ());
+
+  ASSERT_EQ (sum, 0);
+
+  profile_entry limit = profiled::find_entry ("profiled::config::limit");
+  profile_entry name = profiled::find_entry ("profiled::config::name");
+
+  ASSERT_EQ (limit.reads, 10u);
+  ASSERT_EQ (limit.writes, 0u);
+  ASSERT_EQ (limit.mutables, 1000u);
+  ASSERT_EQ (name.reads, 10u);
+  ASSERT_EQ (name.writes, 0u);
+  ASSERT_EQ (name.mutables, 1000u);
+}
+
+TEST (profile_property, setters)
+{
+  profiled::config x {};
+  std::string value = "abc";
+
+  for (int i = 0; i < 5; i ++)
+    x.limit (i);
+
+  x.name (value);
+  x.name (std::move (value));
+
+  profile_entry limit = profiled::find_entry ("profiled::config::limit");
+  profile_entry name = profiled::find_entry ("profiled::config::name");
+
+  // Counted once, not again by the nonconst getter.
+  ASSERT_EQ (limit.writes, 5u);
+  ASSERT_EQ (limit.mutables, 1000u);
+  ASSERT_EQ (name.writes, 2u);
+  ASSERT_EQ (name.mutables, 1000u);
+}
+
+TEST (profile_property, emplace)
+{
+  profiled::buffers x;
+  const profiled::buffers &cx = x;
+
+  x.str_emplace ("abc");
+  x.str_emplace (3u, 'x');
+  x.str_emplace (std::pmr::string {"def"});
+  ASSERT_EQ (cx.str (), "def");
+
+  // All instances of the member template count for the property.
+  profile_entry str = profiled::find_entry ("profiled::buffers::str");
+
+  ASSERT_EQ (str.reads, 1u);
+  ASSERT_EQ (str.writes, 3u);
+  ASSERT_EQ (str.mutables, 0u);
+  ASSERT_EQ (profiled::count_entries ("profiled::buffers::"), 1u);
+}
+
+TEST (profile_property, class_template)
+{
+  profiled::holder<int> i;
+  profiled::holder<long> l;
+
+  i.value (1);
+  l.value (2);
+  l.value (3);
+
+  profile_entry int_value = profiled::find_entry
+    ("profiled::holder<T>::value [with T = int]");
+  profile_entry long_value = profiled::find_entry
+    ("profiled::holder<T>::value [with T = long int]");
+
+  ASSERT_EQ (int_value.writes, 1u);
+  ASSERT_EQ (long_value.writes, 2u);
+}
+
+TEST (profile_property, defer)
+{
+  profiled::deferred x {};
+  const profiled::deferred &cx = x;
+
+  // The owner assigns directly.
+  x.num (1);
+
+  std::thread producer {[&x] () {
+    for (int i = 0; i < 100; i ++)
+      x.num (i);
+  }};
+
+  producer.join ();
+  ASSERT_EQ (x.apply_pending (), 100u);
+  ASSERT_EQ (cx.num (), 99);
+
+  // Applying the updates does not count them again.
+  profile_entry num = profiled::find_entry ("profiled::deferred::num");
+
+  ASSERT_EQ (num.reads, 1u);
+  ASSERT_EQ (num.writes, 101u);
+  ASSERT_EQ (num.mutables, 0u);
+  ASSERT_EQ (num.threads, 2u);
+}
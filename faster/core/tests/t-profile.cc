@@ -0,0 +1,184 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Count every access, so the counts are exact.
+#define FASTER_PROFILE_PERIOD 1
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <faster/core/profile.hh>
+
+using faster::core::profile_entry;
+using faster::core::profile_registry;
+using faster::core::profile_site;
+using faster::core::detail::property_name;
+
+namespace
+{
+  // Accessors like the ones generated by "gen_property --profile".
+  template <typename T>
+  class profiled
+  {
+  public:
+    const T &
+    value () const noexcept
+    {
+      static profile_site site {__PRETTY_FUNCTION__, "value"};
+      site.read ();
+      return value_;
+    }
+
+    void
+    value (const T &value) noexcept
+    {
+      static profile_site site {__PRETTY_FUNCTION__, "value"};
+      site.write ();
+      value_ = value;
+    }
+
+    T &
+    value () noexcept
+    {
+      static profile_site site {__PRETTY_FUNCTION__, "value"};
+      site.mutable_access ();
+      return value_;
+    }
+
+  private:
+    T value_ {};
+  };
+
+  profile_entry
+  find_entry (const std::string &type)
+  {
+    for (const auto &entry : profile_registry::instance ().snapshot ())
+      if (entry.property == "{anonymous}::profiled<T>::value [with T = "
+          + type + "]")
+        return entry;
+
+    return {};
+  }
+}
+
+TEST (profile, property_name)
+{
+  ASSERT_EQ (property_name ("const int& ns::cls::name() const", "name"),
+             "ns::cls::name");
+  ASSERT_EQ (property_name ("void cls::name(std::string&&)", "name"),
+             "cls::name");
+  ASSERT_EQ (property_name ("int* cls::name()", "name"), "cls::name");
+  ASSERT_EQ (property_name ("T& cls<std::pair<int, int> >::name() ", "name"),
+             "cls<std::pair<int, int> >::name");
+  ASSERT_EQ (property_name ("const T& cls<T>::name() const [with T = int]",
+                            "name"),
+             "cls<T>::name [with T = int]");
+  ASSERT_EQ (property_name ("void cls::name(void (*)(int))", "name"),
+             "cls::name");
+  ASSERT_EQ (property_name ("int name()", "name"), "name");
+
+  // Arguments of member templates are dropped.
+  ASSERT_EQ (property_name ("void pm::s_emplace(s_arg_types&& ...) "
+                            "[with s_arg_types = {const char (&)[4]}]", "s"),
+             "pm::s");
+  ASSERT_EQ (property_name ("void cls<T>::s_emplace(s_arg_types&& ...) "
+                            "[with s_arg_types = {int [2], int}; T = int]",
+                            "s"),
+             "cls<T>::s [with T = int]");
+
+  // Like Clang describes them.
+  ASSERT_EQ (property_name ("void cls<T>::in<U>::f() [U = char, "
+                            "T = long]", "f"),
+             "cls<T>::in<U>::f [with U = char, T = long]");
+  ASSERT_EQ (property_name ("void cls<int>::s_emplace(s_arg_types &&...) "
+                            "[T = int, s_arg_types = <const char (&)[4], "
+                            "int>]", "s"),
+             "cls<int>::s");
+}
+
+TEST (profile, counts)
+{
+  profiled<int> x;
+  const profiled<int> &cx = x;
+
+  for (int i = 0; i < 30; i ++)
+    x.value (cx.value () + 1);
+
+  for (int i = 0; i < 70; i ++)
+    (void) cx.value ();
+
+  for (int i = 0; i < 5; i ++)
+    x.value () ++;
+
+  profile_entry entry = find_entry ("int");
+
+  // All accessors are summed into one property.
+  ASSERT_EQ (entry.reads, 100u);
+  ASSERT_EQ (entry.writes, 30u);
+  ASSERT_EQ (entry.mutables, 5u);
+  ASSERT_EQ (entry.threads, 1u);
+}
+
+TEST (profile, threads)
+{
+  profiled<long> x;
+  const profiled<long> &cx = x;
+
+  std::vector<std::thread> readers;
+
+  for (int t = 0; t < 3; t ++)
+    readers.emplace_back ([&cx] () {
+      for (int i = 0; i < 1000; i ++)
+        (void) cx.value ();
+    });
+
+  for (auto &reader : readers)
+    reader.join ();
+
+  // Finished threads are kept in the totals, this one is still live.
+  x.value (1);
+
+  profile_entry entry = find_entry ("long int");
+
+  ASSERT_EQ (entry.reads, 3000u);
+  ASSERT_EQ (entry.writes, 1u);
+  ASSERT_EQ (entry.threads, 4u);
+}
+
+TEST (profile, report)
+{
+  profiled<char> x;
+
+  for (int i = 0; i < 5; i ++)
+    x.value ('a');
+
+  std::ostringstream out;
+  profile_registry::instance ().report (out);
+
+  std::string report = out.str ();
+  std::size_t long_line = report.find ("[with T = long int]");
+  std::size_t char_line = report.find ("[with T = char]");
+
+  // The most accessed properties come first.
+  ASSERT_NE (char_line, std::string::npos);
+  ASSERT_NE (long_line, std::string::npos);
+  ASSERT_LT (long_line, char_line);
+}
@@ -15,12 +15,23 @@
  * limitations under the License.
  */
 
+#include <chrono>
+#include <memory_resource>
 #include <mutex>
 #include <shared_mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
+#include <faster/core/arena.hh>
+#include <faster/core/deferred.hh>
+#include <faster/core/double_buffer.hh>
+#include <faster/core/observable.hh>
 #include <faster/core/property.hh>
+#include <faster/core/replicated.hh>
+#include <faster/core/shared_mutex.hh>
+#include <faster/core/waitable.hh>
 
 // Here, we only test some variants.
 
@@ -158,3 +169,272 @@ TEST (property, pbv)
   x.num (789);
   ASSERT_EQ (x.num (), 789);
 }
+
+namespace
+{
+  // Member templates are not allowed in local classes.
+  class wait_test_class
+  {
+  public:
+    wait_test_class ()
+      noexcept
+      : state_ {1}
+    {
+    }
+
+    FASTER_PROPERTY_PBV_WAIT (state, int)
+  };
+}
+
+TEST (property, wait)
+{
+  wait_test_class x;
+  ASSERT_EQ (x.state (), 1);
+
+  // Does not block, the value is already different.
+  x.state_wait (0);
+
+  std::thread waker {[&x] () {
+    x.state (2);
+    x.state_wait (2);
+  }};
+
+  x.state_wait (1);
+  ASSERT_EQ (x.state (), 2);
+  x.state (3);
+  waker.join ();
+
+  ASSERT_FALSE (x.state_wait_for ([] (int v) { return v == 4; },
+                                  std::chrono::milliseconds {10}));
+  ASSERT_TRUE (x.state_wait_for ([] (int v) { return v == 3; },
+                                 std::chrono::milliseconds {10}));
+
+  // A timeout overflowing the clock means waiting forever.
+  std::thread late_waker {[&x] () {
+    std::this_thread::sleep_for (std::chrono::milliseconds {10});
+    x.state (5);
+  }};
+
+  ASSERT_TRUE (x.state_wait_for ([] (int v) { return v == 5; },
+                                 std::chrono::hours::max ()));
+  late_waker.join ();
+}
+
+TEST (property, replicated)
+{
+  class test_class
+  {
+  public:
+    test_class ()
+      : str_ {"123"}, num_ {1}
+    {
+    }
+
+    FASTER_PROPERTY_REPLICATED (str, std::string)
+    FASTER_PROPERTY_PBV_REPLICATED (num, int)
+  };
+
+  test_class x;
+  ASSERT_EQ (x.str (), "123");
+  ASSERT_EQ (x.num (), 1);
+
+  x.str ("456");
+  x.num (2);
+  ASSERT_EQ (x.str (), "456");
+  ASSERT_EQ (x.num (), 2);
+
+  std::string value = "789";
+  x.str (std::move (value));
+  ASSERT_EQ (x.str (), "789");
+}
+
+TEST (property, drwlock)
+{
+  class test_class
+  {
+  public:
+    test_class ()
+      : str_ {"123"}
+    {
+    }
+
+    FASTER_PROPERTY_DRWLOCK (str, std::string)
+  };
+
+  test_class x;
+
+  {
+    std::shared_lock lock {x.str_lock ()};
+
+    ASSERT_EQ (x.str (), "123");
+  }
+
+  {
+    std::unique_lock lock {x.str_lock ()};
+
+    x.str ("456");
+  }
+
+  ASSERT_EQ (x.str (), "456");
+}
+
+TEST (property, defer)
+{
+  class test_class
+  {
+  public:
+    test_class ()
+      : str_ {"123"}, num_ {1}
+    {
+    }
+
+    FASTER_PENDING_QUEUE
+    FASTER_PROPERTY_DEFER (str, std::string)
+    FASTER_PROPERTY_PBV_DEFER (num, int)
+  };
+
+  test_class x;
+
+  // The owner assigns directly.
+  x.num (2);
+  ASSERT_EQ (x.num (), 2);
+
+  std::thread producer {[&x] () {
+    std::string value = "789";
+
+    x.num (3);
+    x.str ("456");
+    x.str (std::move (value));
+  }};
+
+  producer.join ();
+  ASSERT_EQ (x.num (), 2);
+  ASSERT_EQ (x.str (), "123");
+
+  ASSERT_EQ (x.apply_pending (), 3u);
+  ASSERT_EQ (x.num (), 3);
+  ASSERT_EQ (x.str (), "789");
+  ASSERT_EQ (x.apply_pending (), 0u);
+}
+
+TEST (property, dbuf)
+{
+  class test_class
+  {
+  public:
+    FASTER_PROPERTY_DBUF (frame, std::vector<int>)
+    FASTER_PROPERTY_PBV_DBUF (number, int)
+  };
+
+  test_class x;
+  const test_class &cx = x;
+
+  x.frame ().assign (3, 1);
+  x.number (1);
+  ASSERT_TRUE (cx.frame ().empty ());
+  ASSERT_EQ (cx.number (), 0);
+
+  x.frame_publish ();
+  x.number_publish ();
+  ASSERT_EQ (cx.frame (), (std::vector<int> {1, 1, 1}));
+  ASSERT_EQ (cx.number (), 1);
+
+  // The back buffer now holds an older value.
+  ASSERT_TRUE (x.frame ().empty ());
+  x.frame ({2, 2});
+  ASSERT_EQ (cx.frame (), (std::vector<int> {1, 1, 1}));
+  x.frame_publish ();
+  ASSERT_EQ (cx.frame (), (std::vector<int> {2, 2}));
+}
+
+TEST (property, obs)
+{
+  class test_class
+  {
+  public:
+    test_class ()
+      : str_ {"123"}, num_ {1}
+    {
+    }
+
+    FASTER_NOTIFICATION_HUB
+    FASTER_PROPERTY_OBS (str, std::string)
+    FASTER_PROPERTY_PBV_OBS (num, int)
+  };
+
+  test_class x;
+  std::vector<std::string> changes;
+
+  // Nobody observes num, so changing it is not recorded.
+  x.num (2);
+  ASSERT_EQ (x.num (), 2);
+  ASSERT_EQ (x.flush_notifications (), 0u);
+
+  x.str_observe ([&changes] (const std::string &old_value,
+                             const std::string &new_value) {
+    changes.push_back (old_value + "->" + new_value);
+  });
+
+  std::string value = "789";
+  x.str ("456");
+  x.str (std::move (value));
+  x.num (3);
+  ASSERT_EQ (x.str (), "789");
+  ASSERT_TRUE (changes.empty ());
+
+  ASSERT_EQ (x.flush_notifications (), 1u);
+  ASSERT_EQ (changes, (std::vector<std::string> {"123->789"}));
+  ASSERT_EQ (x.flush_notifications (), 0u);
+}
+
+namespace
+{
+  class pmr_test_class
+  {
+  public:
+    explicit
+    pmr_test_class (std::pmr::memory_resource *resource)
+      : faster_memory_resource_ {resource}
+    {
+    }
+
+    FASTER_MEMORY_RESOURCE
+    FASTER_PROPERTY_PMR (str, std::pmr::string)
+    FASTER_PROPERTY_PMR (numbers, std::pmr::vector<int>)
+    FASTER_PROPERTY_PMR (flags, std::pmr::vector<bool>)
+    FASTER_PROPERTY_PMR (pointers, std::pmr::vector<const void *>)
+  };
+}
+
+TEST (property, pmr)
+{
+  faster::core::arena arena;
+  pmr_test_class x {&arena};
+
+  ASSERT_EQ (x.faster_memory_resource (), &arena);
+  ASSERT_EQ (x.str ().get_allocator ().resource (), &arena);
+  ASSERT_EQ (x.numbers ().get_allocator ().resource (), &arena);
+
+  // Not one-element vectors of the resource pointer.
+  ASSERT_TRUE (x.flags ().empty ());
+  ASSERT_EQ (x.flags ().get_allocator ().resource (), &arena);
+  ASSERT_TRUE (x.pointers ().empty ());
+  ASSERT_EQ (x.pointers ().get_allocator ().resource (), &arena);
+
+  // Values from the default heap are copied into the arena.
+  std::pmr::string heap_value (40, 'x');
+  x.str (heap_value);
+  ASSERT_EQ (x.str (), heap_value);
+  ASSERT_EQ (x.str ().get_allocator ().resource (), &arena);
+
+  x.str (std::pmr::string (50, 'y'));
+  ASSERT_EQ (x.str ().get_allocator ().resource (), &arena);
+
+  x.numbers_emplace (3u, 7);
+  ASSERT_EQ (x.numbers (), (std::pmr::vector<int> {7, 7, 7}));
+  ASSERT_EQ (x.numbers ().get_allocator ().resource (), &arena);
+
+  x.str_emplace ("abc");
+  ASSERT_EQ (x.str (), "abc");
+  ASSERT_EQ (x.str ().get_allocator ().resource (), &arena);
+}
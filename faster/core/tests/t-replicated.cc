@@ -0,0 +1,175 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+# include <sched.h>
+#endif
+
+#include <gtest/gtest.h>
+#include <faster/core/replicated.hh>
+#include <faster/core/topology.hh>
+
+using faster::core::node_affinity;
+using faster::core::numa_topology;
+using faster::core::replicated;
+
+TEST (topology, cpu_list)
+{
+  using cpus = std::vector<unsigned>;
+
+  ASSERT_EQ (numa_topology::parse_cpu_list ("0-3,8,10-11\n"),
+             (cpus {0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_EQ (numa_topology::parse_cpu_list (""), cpus {});
+}
+
+TEST (topology, sysfs)
+{
+  namespace fs = std::filesystem;
+
+  fs::path root = fs::temp_directory_path () / "faster-t-replicated";
+  fs::remove_all (root);
+
+  // Sparse node numbers and unrelated entries, like on real machines.
+  for (auto [node, list] : {std::pair {"node0", "0-1,4"},
+                            std::pair {"node2", "2-3"}})
+    {
+      fs::create_directories (root / node);
+      std::ofstream {root / node / "cpulist"} << list << '\n';
+    }
+
+  fs::create_directories (root / "power");
+  std::ofstream {root / "possible"} << "0,2\n";
+
+  numa_topology topology = numa_topology::from_sysfs (root);
+  fs::remove_all (root);
+
+  ASSERT_EQ (topology.nodes (), 2u);
+  ASSERT_EQ (topology.node_of_cpu (0), 0u);
+  ASSERT_EQ (topology.node_of_cpu (2), 1u);
+  ASSERT_EQ (topology.node_of_cpu (4), 0u);
+
+  // Missing directory: a single node.
+  ASSERT_EQ (numa_topology::from_sysfs (root).nodes (), 1u);
+}
+
+#ifdef __linux__
+TEST (topology, node_affinity)
+{
+  cpu_set_t old;
+  ASSERT_EQ (sched_getaffinity (0, sizeof old, &old), 0);
+
+  unsigned cpu = sched_getcpu ();
+  numa_topology topology {{{cpu}, {}}};
+
+  ASSERT_EQ (topology.cpus (0), std::vector<unsigned> {cpu});
+  ASSERT_TRUE (topology.cpus (1).empty ());
+  ASSERT_TRUE (topology.cpus (2).empty ());
+
+  {
+    node_affinity affinity {topology, 0};
+    cpu_set_t pinned;
+
+    ASSERT_TRUE (affinity.pinned ());
+    ASSERT_EQ (sched_getaffinity (0, sizeof pinned, &pinned), 0);
+    ASSERT_EQ (CPU_COUNT (&pinned), 1);
+    ASSERT_TRUE (CPU_ISSET (cpu, &pinned));
+    ASSERT_EQ (static_cast<unsigned> (sched_getcpu ()), cpu);
+  }
+
+  // Unknown CPUs: nothing to pin to.
+  ASSERT_FALSE ((node_affinity {topology, 1}.pinned ()));
+
+  // Constructing replicas pins and restores the thread.
+  numa_topology same {{{cpu}, {cpu}}};
+  replicated<std::string> x {"a", same};
+  cpu_set_t now;
+
+  ASSERT_EQ (x.load (1), "a");
+  ASSERT_EQ (sched_getaffinity (0, sizeof now, &now), 0);
+  ASSERT_TRUE (CPU_EQUAL (&now, &old));
+}
+#endif
+
+// The topology is kept by reference, it cannot be a temporary.
+static_assert (std::is_constructible_v<replicated<int>, int,
+                                       const numa_topology &>);
+static_assert (!std::is_constructible_v<replicated<int>, int,
+                                        numa_topology &&>);
+
+TEST (replicated, single_node)
+{
+  numa_topology topology;
+  replicated<int> x {1, topology};
+
+  ASSERT_EQ (x.replicas (), 1u);
+  ASSERT_EQ (x.load (), 1);
+  x.store (2);
+  ASSERT_EQ (x.load (), 2);
+}
+
+TEST (replicated, fake_nodes)
+{
+  numa_topology topology {{{0, 1}, {2, 3}, {4, 5}}};
+  replicated<std::string> x {"a", topology};
+
+  ASSERT_EQ (x.replicas (), 3u);
+
+  x.store ("b");
+
+  for (std::size_t node = 0; node < 3; node ++)
+    ASSERT_EQ (x.load (node), "b");
+
+  std::string value = "c";
+  x.store (std::move (value));
+
+  for (std::size_t node = 0; node < 3; node ++)
+    ASSERT_EQ (x.load (node), "c");
+}
+
+TEST (replicated, concurrent)
+{
+  numa_topology topology {{{0}, {1}}};
+  replicated<long> x {0, topology};
+
+  std::thread writer {[&x] () {
+    for (long i = 1; i <= 10000; i ++)
+      x.store (i);
+  }};
+
+  long last = 0;
+
+  // Every replica only moves forward.
+  for (int i = 0; i < 100000; i ++)
+    {
+      long value = x.load (i % 2);
+      ASSERT_GE (value, i % 2 ? 0 : last);
+
+      if (i % 2 == 0)
+        last = value;
+    }
+
+  writer.join ();
+  ASSERT_EQ (x.load (0), 10000);
+  ASSERT_EQ (x.load (1), 10000);
+}
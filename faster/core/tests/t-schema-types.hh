@@ -0,0 +1,82 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_TESTS_T_SCHEMA_TYPES_HH__
+#define __FASTER_CORE_TESTS_T_SCHEMA_TYPES_HH__
+
+// User types for t-schema.schema, which includes this header in quotes.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace schema_test
+{
+  struct point
+  {
+    std::int32_t x;
+    std::int32_t y;
+  };
+
+  // Has padding after c, which must not be compared.
+  struct padded
+  {
+    char c;
+    std::int32_t i;
+  };
+
+  inline bool
+  operator== (const padded &a,
+              const padded &b)
+    noexcept
+  {
+    return a.c == b.c && a.i == b.i;
+  }
+
+  inline bool
+  operator== (const point &a,
+              const point &b)
+    noexcept
+  {
+    return a.x == b.x && a.y == b.y;
+  }
+}
+
+template <>
+struct std::hash<schema_test::point>
+{
+  std::size_t
+  operator() (const schema_test::point &p)
+    const noexcept
+  {
+    return std::hash<std::int32_t> {} (p.x) * 31
+      + std::hash<std::int32_t> {} (p.y);
+  }
+};
+
+template <>
+struct std::hash<schema_test::padded>
+{
+  std::size_t
+  operator() (const schema_test::padded &p)
+    const noexcept
+  {
+    return std::hash<char> {} (p.c) * 31 + std::hash<std::int32_t> {} (p.i);
+  }
+};
+
+#endif /* __FASTER_CORE_TESTS_T_SCHEMA_TYPES_HH__ */
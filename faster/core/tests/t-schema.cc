@@ -0,0 +1,124 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include <gtest/gtest.h>
+#include "t-schema.hh"
+
+using schema_test::schema_test_class;
+
+TEST (schema, accessors)
+{
+  schema_test_class x;
+
+  ASSERT_EQ (x.id (), 42u);
+  ASSERT_EQ (x.name (), "none");
+  ASSERT_EQ (x.ratio (), 0.5);
+  ASSERT_FALSE (x.flag ());
+
+  x.id (7);
+  x.small (3);
+  x.name ("abc");
+  x.flag (true);
+  x.state (5);
+  x.origin ({1, 2});
+
+  {
+    std::lock_guard lock {x.count_lock ()};
+    x.count (9);
+  }
+
+  ASSERT_EQ (x.id (), 7u);
+  ASSERT_EQ (x.small (), 3);
+  ASSERT_EQ (x.name (), "abc");
+  ASSERT_TRUE (x.flag ());
+  ASSERT_EQ (x.state (), 5);
+  ASSERT_EQ (x.count (), 9);
+  ASSERT_EQ (x.origin (), (schema_test::point {1, 2}));
+}
+
+TEST (schema, layout)
+{
+  // The same members in schema order.
+  struct declaration_order
+  {
+    bool flag;
+    std::uint64_t id;
+    std::string name;
+    std::uint8_t small;
+    int count;
+    std::mutex count_lock;
+    double ratio;
+    faster::core::waitable<int> state;
+    schema_test::point origin;
+    schema_test::padded pad;
+  };
+
+  ASSERT_LT (sizeof (schema_test_class), sizeof (declaration_order));
+}
+
+TEST (schema, equality)
+{
+  schema_test_class a;
+  schema_test_class b;
+
+  ASSERT_EQ (a, b);
+  ASSERT_EQ (a.hash (), b.hash ());
+
+  // Within the bytewise run.
+  a.small (1);
+  ASSERT_NE (a, b);
+  b.small (1);
+  ASSERT_EQ (a, b);
+
+  // Fields compared one by one.
+  a.name ("x");
+  ASSERT_NE (a, b);
+  b.name ("x");
+  a.state (2);
+  ASSERT_NE (a, b);
+  b.state (2);
+  ASSERT_EQ (a, b);
+  ASSERT_EQ (a.hash (), b.hash ());
+
+  std::unordered_set<schema_test_class, schema_test_class::hasher> set;
+  set.emplace ();
+  ASSERT_EQ (set.count (schema_test_class {}), 1u);
+  ASSERT_EQ (set.count (a), 0u);
+}
+
+TEST (schema, padded_equality)
+{
+  schema_test_class a;
+  schema_test_class b;
+
+  // Equal members, different padding bytes.
+  std::memset (&a.pad (), 0xff, sizeof (schema_test::padded));
+  a.pad ().c = 'x';
+  a.pad ().i = 1;
+  std::memset (&b.pad (), 0, sizeof (schema_test::padded));
+  b.pad ().c = 'x';
+  b.pad ().i = 1;
+
+  ASSERT_EQ (a, b);
+  ASSERT_EQ (a.hash (), b.hash ());
+}
@@ -0,0 +1,110 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <faster/core/shared_mutex.hh>
+
+using faster::core::distributed_shared_mutex;
+
+TEST (distributed_shared_mutex, try_lock)
+{
+  distributed_shared_mutex m;
+
+  {
+    std::shared_lock a {m};
+    std::shared_lock b {m, std::try_to_lock};
+
+    ASSERT_TRUE (b.owns_lock ());
+    ASSERT_FALSE (m.try_lock ());
+  }
+
+  {
+    std::unique_lock lock {m};
+
+    ASSERT_FALSE (m.try_lock_shared ());
+  }
+
+  ASSERT_TRUE (m.try_lock ());
+  m.unlock ();
+}
+
+TEST (distributed_shared_mutex, exclusion)
+{
+  distributed_shared_mutex m;
+  std::atomic<int> readers {0};
+  std::atomic<int> writers {0};
+  std::atomic<bool> failed {false};
+
+  // Writers update both halves one by one, readers must never see them
+  // differ.  Volatile, so the updates are not merged.
+  volatile long first = 0;
+  volatile long second = 0;
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < 4; t ++)
+    threads.emplace_back ([&, t] () {
+      for (int i = 0; i < 20000; i ++)
+        if (i % 10 == t)
+          {
+            std::unique_lock lock {m};
+
+            if (writers.fetch_add (1) != 0 || readers.load () != 0)
+              failed = true;
+
+            long next = first + 1;
+            first = next;
+
+            // Give overlapping threads a chance to see the halves differ.
+            std::this_thread::yield ();
+
+            second = next;
+
+            if (writers.fetch_sub (1) != 1 || readers.load () != 0)
+              failed = true;
+          }
+        else
+          {
+            std::shared_lock lock {m};
+
+            readers ++;
+
+            if (writers.load () != 0)
+              failed = true;
+
+            long a = first;
+            long b = second;
+
+            if (a != b)
+              failed = true;
+
+            readers --;
+          }
+    });
+
+  for (auto &thread : threads)
+    thread.join ();
+
+  ASSERT_FALSE (failed.load ());
+  ASSERT_EQ (first, 4 * 2000);
+  ASSERT_EQ (second, 4 * 2000);
+}
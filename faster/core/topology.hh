@@ -0,0 +1,285 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_TOPOLOGY_HH__
+#define __FASTER_CORE_TOPOLOGY_HH__
+
+/*
+ * NUMA topology
+ *
+ * SUMMARY
+ *
+ * A numa_topology maps CPUs to nodes, which are numbered densely from 0.  The
+ * topology of the machine is read from /sys/devices/system/node once, on the
+ * first call to numa_topology::system.  Machines without that directory (or
+ * not running Linux) are treated as a single node.
+ *
+ * Topologies can also be read from another directory with the same layout,
+ * or built from a list of CPU groups.  This is useful for testing, and for
+ * treating core groups as nodes.
+ *
+ * A node_affinity pins the calling thread to the CPUs of a node while it
+ * exists.  Memory first touched meanwhile is then, by default, allocated on
+ * that node.
+ */
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+# include <sched.h>
+#endif
+
+namespace faster::core
+{
+  class numa_topology
+  {
+  public:
+    /*
+     * A single node containing all CPUs.
+     */
+    numa_topology ()
+      noexcept
+      : cpu_node_ {}, node_cpus_ {}, nodes_ {1}
+    {
+    }
+
+    /*
+     * Node i contains the CPUs listed in node_cpus[i].  An empty list gives
+     * a single node.
+     */
+    explicit
+    numa_topology (const std::vector<std::vector<unsigned>> &node_cpus)
+      : cpu_node_ {}, node_cpus_ {node_cpus},
+        nodes_ {node_cpus.empty () ? 1 : node_cpus.size ()}
+    {
+      for (std::size_t node = 0; node < node_cpus.size (); node ++)
+        for (unsigned cpu : node_cpus[node])
+          {
+            if (cpu >= cpu_node_.size ())
+              cpu_node_.resize (cpu + 1, 0);
+
+            cpu_node_[cpu] = node;
+          }
+    }
+
+    /*
+     * Reads a sysfs-like directory, containing node<N>/cpulist files.
+     */
+    static numa_topology
+    from_sysfs (const std::filesystem::path &root)
+    {
+      namespace fs = std::filesystem;
+
+      std::map<unsigned long, std::vector<unsigned>> nodes;
+      std::error_code ec;
+
+      for (fs::directory_iterator it {root, ec}, end; !ec && it != end;
+           it.increment (ec))
+        {
+          std::string name = it->path ().filename ().string ();
+
+          if (name.size () <= 4 || name.compare (0, 4, "node") != 0
+              || name.find_first_not_of ("0123456789", 4)
+                 != std::string::npos)
+            continue;
+
+          std::ifstream in {it->path () / "cpulist"};
+          std::string list;
+
+          if (std::getline (in, list))
+            nodes[std::stoul (name.substr (4))] = parse_cpu_list (list);
+        }
+
+      std::vector<std::vector<unsigned>> node_cpus;
+
+      for (auto &node : nodes)
+        node_cpus.push_back (std::move (node.second));
+
+      return numa_topology {node_cpus};
+    }
+
+    /*
+     * The topology of this machine.
+     */
+    static const numa_topology &
+    system ()
+    {
+      static const numa_topology topology
+        = from_sysfs ("/sys/devices/system/node");
+
+      return topology;
+    }
+
+    /*
+     * Parses a CPU list, like "0-3,8,10-11".
+     */
+    static std::vector<unsigned>
+    parse_cpu_list (const std::string &list)
+    {
+      std::vector<unsigned> cpus;
+      std::size_t pos = 0;
+
+      while (pos < list.size ())
+        {
+          std::size_t end = list.find (',', pos);
+
+          if (end == std::string::npos)
+            end = list.size ();
+
+          std::string range = list.substr (pos, end - pos);
+          std::size_t dash = range.find ('-');
+
+          if (range.find_first_of ("0123456789") != std::string::npos)
+            {
+              unsigned first = std::stoul (range);
+              unsigned last = dash == std::string::npos ? first
+                : std::stoul (range.substr (dash + 1));
+
+              for (unsigned cpu = first; cpu <= last; cpu ++)
+                cpus.push_back (cpu);
+            }
+
+          pos = end + 1;
+        }
+
+      return cpus;
+    }
+
+    std::size_t
+    nodes ()
+      const noexcept
+    {
+      return nodes_;
+    }
+
+    /*
+     * The node of the given CPU, or 0 if it is not known.
+     */
+    std::size_t
+    node_of_cpu (unsigned cpu)
+      const noexcept
+    {
+      return cpu < cpu_node_.size () ? cpu_node_[cpu] : 0;
+    }
+
+    /*
+     * The CPUs of the given node, empty if they are not known.
+     */
+    const std::vector<unsigned> &
+    cpus (std::size_t node)
+      const noexcept
+    {
+      static const std::vector<unsigned> none;
+
+      return node < node_cpus_.size () ? node_cpus_[node] : none;
+    }
+
+    /*
+     * The node the calling thread is running on right now.  It may of course
+     * change at any moment.
+     */
+    std::size_t
+    current_node ()
+      const noexcept
+    {
+      if (nodes_ == 1)
+        return 0;
+
+#ifdef __linux__
+      int cpu = sched_getcpu ();
+
+      if (cpu >= 0)
+        return node_of_cpu (cpu);
+#endif
+
+      return 0;
+    }
+
+  private:
+    std::vector<std::size_t> cpu_node_;
+    std::vector<std::vector<unsigned>> node_cpus_;
+    std::size_t nodes_;
+  };
+
+  /*
+   * Pins the calling thread to the CPUs of a node, and restores its affinity
+   * when destroyed.  Does nothing if the CPUs are not known or the thread may
+   * not run on them.
+   */
+  class node_affinity
+  {
+  public:
+    node_affinity (const numa_topology &topology,
+                   std::size_t node)
+      noexcept
+      : pinned_ {false}
+    {
+#ifdef __linux__
+      const std::vector<unsigned> &cpus = topology.cpus (node);
+
+      if (cpus.empty () || sched_getaffinity (0, sizeof old_, &old_) != 0)
+        return;
+
+      cpu_set_t set;
+      CPU_ZERO (&set);
+
+      for (unsigned cpu : cpus)
+        if (cpu < CPU_SETSIZE)
+          CPU_SET (cpu, &set);
+
+      // The kernel moves the thread before returning.
+      pinned_ = sched_setaffinity (0, sizeof set, &set) == 0;
+#else
+      (void) topology;
+      (void) node;
+#endif
+    }
+
+    node_affinity (const node_affinity &) = delete;
+    node_affinity &operator= (const node_affinity &) = delete;
+
+    ~node_affinity ()
+    {
+#ifdef __linux__
+      if (pinned_)
+        sched_setaffinity (0, sizeof old_, &old_);
+#endif
+    }
+
+    bool
+    pinned ()
+      const noexcept
+    {
+      return pinned_;
+    }
+
+  private:
+    bool pinned_;
+#ifdef __linux__
+    cpu_set_t old_;
+#endif
+  };
+}
+
+#endif /* __FASTER_CORE_TOPOLOGY_HH__ */
@@ -0,0 +1,246 @@
+/*
+ * Faster - a C++ miscellaneous utility library
+ * Copyright 2020  Jakub Kaszycki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FASTER_CORE_WAITABLE_HH__
+#define __FASTER_CORE_WAITABLE_HH__
+
+/*
+ * Waitable values
+ *
+ * SUMMARY
+ *
+ * A waitable value is an atomic PBV value which other threads can block on
+ * until it changes.  It backs the *_WAIT property variants, but may be used
+ * on its own as well.
+ *
+ * IMPLEMENTATION
+ *
+ * Next to the value there is a 32-bit state word.  Its lowest bit is set by
+ * threads about to sleep, the remaining bits are a generation counter.  A
+ * store only touches the state word if the waiter bit is set, in which case
+ * it clears the bit, bumps the generation and wakes all sleepers.  A store
+ * with nobody waiting is thus a plain atomic store followed by a load.
+ *
+ * On Linux the sleeping is done using a private futex on the state word.
+ * Elsewhere, a process-wide mutex and condition variable are used instead.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+#ifdef __linux__
+# include <ctime>
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#else
+# include <condition_variable>
+# include <mutex>
+#endif
+
+namespace faster::core
+{
+  namespace detail
+  {
+#ifndef __linux__
+    inline std::mutex waitable_mutex;
+    inline std::condition_variable waitable_cv;
+#endif
+
+    /*
+     * Sleeps while word contains expected, at most for timeout (if not
+     * null).  May return spuriously.
+     */
+    inline void
+    futex_wait (const std::atomic<std::uint32_t> &word,
+                std::uint32_t expected,
+                const std::chrono::nanoseconds *timeout)
+      noexcept
+    {
+#ifdef __linux__
+      std::timespec ts;
+      std::timespec *tsp = nullptr;
+
+      if (timeout)
+        {
+          ts.tv_sec = timeout->count () / 1000000000;
+          ts.tv_nsec = timeout->count () % 1000000000;
+          tsp = &ts;
+        }
+
+      syscall (SYS_futex, &word, FUTEX_WAIT_PRIVATE, expected, tsp,
+               nullptr, 0);
+#else
+      std::unique_lock lock {waitable_mutex};
+
+      if (word.load () != expected)
+        return;
+
+      if (timeout)
+        waitable_cv.wait_for (lock, *timeout);
+      else
+        waitable_cv.wait (lock);
+#endif
+    }
+
+    /*
+     * Wakes all threads sleeping on word.
+     */
+    inline void
+    futex_wake_all (const std::atomic<std::uint32_t> &word)
+      noexcept
+    {
+#ifdef __linux__
+      syscall (SYS_futex, &word, FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr,
+               nullptr, 0);
+#else
+      (void) word;
+
+      std::lock_guard lock {waitable_mutex};
+      waitable_cv.notify_all ();
+#endif
+    }
+  }
+
+  template <typename T>
+  class waitable
+  {
+    static_assert (std::is_trivially_copyable_v<T>,
+                   "waitable values must be trivially copyable");
+
+  public:
+    constexpr
+    waitable ()
+      noexcept
+      : value_ {}, state_ {0}
+    {
+    }
+
+    constexpr
+    waitable (T value)
+      noexcept
+      : value_ {value}, state_ {0}
+    {
+    }
+
+    waitable (const waitable &) = delete;
+    waitable &operator= (const waitable &) = delete;
+
+    T
+    load ()
+      const noexcept
+    {
+      return value_.load ();
+    }
+
+    void
+    store (T value)
+      noexcept
+    {
+      value_.store (value);
+
+      // Pairs with the fetch_or in wait_until: either we see the waiter bit
+      // here, or the waiter sees the new value before going to sleep.
+      std::uint32_t state = state_.load ();
+
+      while (state & WAITERS)
+        if (state_.compare_exchange_weak (state, state + 1))
+          {
+            // state + 1 cleared the bit and bumped the generation.
+            detail::futex_wake_all (state_);
+            break;
+          }
+    }
+
+    /*
+     * Blocks until the value is different from old.
+     */
+    void
+    wait (T old)
+      const noexcept
+    {
+      wait_until ([old] (T value) { return value != old; }, nullptr);
+    }
+
+    /*
+     * Blocks until pred returns true for the value, but no longer than
+     * timeout.  Returns the last result of pred.  Timeouts too long to be
+     * represented as a deadline (like hours::max ()) mean no timeout.
+     */
+    template <typename Pred, typename Rep, typename Period>
+    bool
+    wait_for (Pred pred,
+              const std::chrono::duration<Rep, Period> &timeout)
+      const
+    {
+      using clock = std::chrono::steady_clock;
+
+      clock::time_point now = clock::now ();
+
+      // Compared as doubles, converting either duration could overflow.
+      if (std::chrono::duration<double> (timeout)
+          >= std::chrono::duration<double> (clock::time_point::max () - now))
+        return wait_until (pred, nullptr);
+
+      clock::time_point deadline
+        = now + std::chrono::duration_cast<clock::duration> (timeout);
+      return wait_until (pred, &deadline);
+    }
+
+  private:
+    static constexpr std::uint32_t WAITERS = 1;
+
+    template <typename Pred>
+    bool
+    wait_until (Pred pred,
+                const std::chrono::steady_clock::time_point *deadline)
+      const
+    {
+      if (pred (value_.load ()))
+        return true;
+
+      for (;;)
+        {
+          std::uint32_t state = state_.fetch_or (WAITERS) | WAITERS;
+
+          if (pred (value_.load ()))
+            return true;
+
+          if (deadline)
+            {
+              auto left = *deadline - std::chrono::steady_clock::now ();
+
+              if (left <= left.zero ())
+                return false;
+
+              auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>
+                (left);
+              detail::futex_wait (state_, state, &ns);
+            }
+          else
+            detail::futex_wait (state_, state, nullptr);
+        }
+    }
+
+    std::atomic<T> value_;
+    mutable std::atomic<std::uint32_t> state_;
+  };
+}
+
+#endif /* __FASTER_CORE_WAITABLE_HH__ */
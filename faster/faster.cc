@@ -2,4 +2,14 @@
  * This file is for compiler flags only.
  */
 
+#include <faster/core/arena.hh>
+#include <faster/core/bytes.hh>
+#include <faster/core/deferred.hh>
+#include <faster/core/double_buffer.hh>
+#include <faster/core/observable.hh>
+#include <faster/core/profile.hh>
 #include <faster/core/property.hh>
+#include <faster/core/replicated.hh>
+#include <faster/core/shared_mutex.hh>
+#include <faster/core/topology.hh>
+#include <faster/core/waitable.hh>